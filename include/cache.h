@@ -0,0 +1,53 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "db.h"
+#include "page.h"
+#include <stddef.h>
+
+#define CACHE_MAX_ENTRIES 64
+#define CACHE_MAX_BYTES (4 * 1024 * 1024)
+#define CACHE_KEY_SIZE 256
+
+typedef struct {
+    char key[CACHE_KEY_SIZE];
+    unsigned long generation;  // write generation the rows are valid for
+    long frontier;             // heap rows before this location are reflected in rows
+    RecordBuffer rows;         // matches in the page record encoding
+    int size;
+    int uncacheable;           // result outgrew the cache; the key only remembers that
+    unsigned long last_used;
+} CachedResult;
+
+typedef struct {
+    long hits;
+    long misses;
+    long extensions;     // hits that only had to scan rows appended since
+    long invalidations;  // entries dropped because the write generation moved
+    long evictions;      // entries dropped to stay under the caps
+    int entries;
+    size_t bytes;
+} CacheStats;
+
+// Any write that can change or remove an existing row bumps the generation,
+// which retires every cached result. Heap appends do not: a result records
+// the append frontier it covered and is extended past it on its next hit.
+void cache_bump_generation(void);
+
+// Returns the live result for conds, or NULL on a miss. frontier is the
+// current heap append frontier, used to tell full hits from ones needing a
+// tail scan. An uncacheable result is returned too, counted as a miss.
+CachedResult* cache_lookup(ConditionList* conds, long frontier);
+// Creates an empty result for conds, or returns NULL if it cannot be keyed.
+CachedResult* cache_insert(ConditionList* conds);
+// Adds a row to res. A result that would outgrow CACHE_MAX_BYTES on its own
+// gives up its rows and is marked uncacheable until the generation moves;
+// 0 is returned then and for any later append.
+int cache_append(CachedResult* res, const Row* row);
+// Evicts least recently used results until the caps hold; may free res.
+void cache_trim(void);
+
+void cache_clear(void);
+CacheStats cache_stats(void);
+
+#endif
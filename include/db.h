@@ -4,12 +4,27 @@
 #include <stdio.h>
 
 #define DB_FILE "rows.db"
-#define NAME_SIZE 32
+#define ENGINE_FILE "rows.engine"  // engine the table in this directory was created with
+#define DB_MAGIC 0x50414732  // "PAG2", 64-bit forward targets
+#define NAME_SIZE 256         // names are stored at their own length, see page.h
 #define MAX_CONDITIONS 4
 
+typedef enum {
+    ENGINE_HEAP,  // slotted pages in DB_FILE, updated in place, see heap.h
+    ENGINE_LSM    // memtable plus sorted runs, see lsm.h
+} StorageEngine;
+
+typedef struct {
+    StorageEngine engine;
+    int engine_given;    // engine was asked for; an existing table must match it
+    int partition_rows;  // heap only: ids per partition file, 0 for a single DB_FILE
+} DbOptions;
+
 typedef struct {
-    int num_rows;
+    int magic;
+    int num_pages;
     int next_id;
+    int tail_slots;  // slots used on the last page, so appends know where they land
 } DbHeader;
 
 typedef struct {
@@ -31,7 +46,9 @@ typedef enum {
     OP_LT,   // <
     OP_NEQ,  // !=
     OP_GTE,  // >=
-    OP_LTE   // <=
+    OP_LTE,      // <=
+    OP_LIKE,     // like 'abc%', % and _ wildcards
+    OP_CONTAINS  // contains abc
 } Operator;
 
 typedef enum {
@@ -43,7 +60,7 @@ typedef enum {
 typedef struct {
     Field field;
     Operator op;
-    char str_value[32];
+    char str_value[NAME_SIZE];
     int int_value;
 } Condition;
 
@@ -54,6 +71,18 @@ typedef struct {
     int op_count;
 } ConditionList;
 
+typedef enum {
+    AGG_COUNT,
+    AGG_SUM
+} Aggregate;
+
+typedef struct {
+    char name[32];
+    Aggregate agg;
+    Field sum_field;   // AGG_SUM only
+    int group_by_age;
+} ViewSpec;
+
 typedef enum {
     CMD_INSERT,
     CMD_SELECT_ALL,
@@ -62,6 +91,14 @@ typedef enum {
     CMD_UPDATE_WHERE,
     CMD_DELETE,
     CMD_DELETE_WHERE,
+    CMD_BEGIN,
+    CMD_COMMIT,
+    CMD_ROLLBACK,
+    CMD_CACHE_STATS,
+    CMD_DROP_PARTITION,
+    CMD_CREATE_VIEW,
+    CMD_SELECT_VIEW,
+    CMD_DROP_VIEW,
     CMD_EXIT,
     CMD_UNKNOWN
 } CommandType;
@@ -71,13 +108,14 @@ typedef struct {
     ConditionList conds;
     Row row;
     int query_id;
+    ViewSpec view;
 } Command;
 
-void load_header(FILE* f);
-DbHeader* get_header(void);
+StorageEngine get_engine(void);
 
-void db_init();
-void db_insert(Row* row);
+void db_init(const DbOptions* options);
+void db_close();
+int db_insert(Row* row);
 void db_select_all();
 void db_select_where(ConditionList* conds);
 void db_update_by_id(int id, const char* new_name, int new_age);
@@ -85,4 +123,15 @@ void db_update_where(ConditionList* conds, const Row* new_values);
 void db_delete_by_id(int id);
 void db_delete_where(ConditionList* conds);
 
+void db_cache_stats();
+void db_drop_partition(int part);
+
+void db_create_view(const ViewSpec* spec, ConditionList* conds);
+void db_select_view(const char* name);
+void db_drop_view(const char* name);
+
+void db_begin();
+void db_commit();
+void db_rollback();
+
 #endif
@@ -0,0 +1,52 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "db.h"
+#include "page.h"
+#include <stdio.h>
+
+// Heap-engine row storage. Each partition file is a DbHeader followed by
+// slotted pages (page.h). A row's location (partition.h) carries its row
+// id, so index entries stay valid across updates. Page reads and writes go
+// through the open transaction, if any.
+#define HEAP_PAGE_OFFSET(page) ((long)sizeof(DbHeader) + (long)(page) * PAGE_SIZE)
+
+void heap_load_header(FILE* f, int part);
+// Rewrites part in place if it is still in the fixed-row format used
+// before slotted pages, keeping row ids. Returns 1 if it was converted;
+// exits if the conversion fails, leaving the old file as it was.
+int heap_convert_legacy(int part);
+void heap_save_header(FILE* f, int part);
+void heap_read_page(FILE* f, int part, int page, Page* out);
+
+// Reads the row whose home is slot of p, following a forward. Returns 0
+// for tombstones and for relocated records seen away from home.
+int heap_page_row(FILE* f, int part, const Page* p, int slot, Row* out);
+int heap_read_row(FILE* f, long loc, Row* out);
+
+// Appends r on the last page of part and returns its location. The
+// partition header must be loaded; it is saved with the new page count.
+long heap_insert(FILE* f, int part, const Row* r);
+void heap_update(FILE* f, long loc, const Row* r);
+void heap_delete(FILE* f, long loc);
+
+// Location the next appended row would get.
+long heap_end(int part);
+
+// Walks the live rows of a partition in location order from start, a row
+// id, reading one page at a time. Rows on the current page are read from
+// a copy, so callers may update or delete them as they go.
+typedef struct {
+    FILE* f;
+    int part;
+    int page;
+    int slot;
+    int pages;
+    int loaded;
+    Page p;
+} HeapCursor;
+
+void heap_cursor_open(HeapCursor* c, FILE* f, int part, long start);
+int heap_cursor_next(HeapCursor* c, Row* out, long* loc);
+
+#endif
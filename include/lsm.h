@@ -0,0 +1,37 @@
+#ifndef LSM_H
+#define LSM_H
+
+#include "db.h"
+#include "query.h"
+
+#define LSM_MANIFEST_FILE "rows.lsm"
+#define LSM_WAL_FILE "rows.lsm.wal"
+#define LSM_WAL_BATCH_MAGIC 0x4c534d42   // "LSMB", opens each batch of rows in the log
+#define LSM_WAL_COMMIT_MAGIC 0x4c534d43  // "LSMC", written last to mark a complete batch
+#define LSM_MEMTABLE_LIMIT 1024   // rows buffered before a flush to level 0
+#define LSM_L0_LIMIT 4            // level 0 runs before they are merged into level 1
+#define LSM_LEVEL_RATIO 10        // size ratio between consecutive levels
+#define LSM_MAX_LEVELS 8
+#define LSM_BLOOM_BITS_PER_ROW 10
+#define LSM_COMPACTION_MAX_BACKOFF 60  // seconds between retries of a failing compaction
+#define LSM_CURSOR_ROWS 256        // rows a merge reads from a run file at a time
+#define LSM_NAME_SIZE 32          // fixed name field of stored rows, terminator included
+
+void lsm_open(void);
+void lsm_close(void);
+int lsm_next_id(void);
+
+// Inserts or overwrites the row with row->id; a row with is_deleted set
+// is written as a tombstone.
+void lsm_put(const Row* row);
+int lsm_get(int id, Row* out);
+void lsm_scan(ConditionList* conds, RowCallback callback);
+
+// While a transaction is open lsm_put only buffers; commit logs the
+// buffered rows as one batch with a single sync and moves them into the
+// memtable. Returns 0, with the batch still buffered for lsm_rollback, if
+// the batch could not be made durable.
+int lsm_commit(void);
+void lsm_rollback(void);
+
+#endif
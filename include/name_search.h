@@ -0,0 +1,36 @@
+#ifndef NAME_SEARCH_H
+#define NAME_SEARCH_H
+
+#include "db.h"
+
+#define TRIGRAM_BUCKETS 65536
+#define NAME_SEARCH_MIN_DELTA 1024  // recent writes kept apart from the sorted base
+
+// Index over row names: sorted (name, location) entries for prefix and
+// equality lookups, and a trigram table for substring lookups. The heap
+// engine keys it by location; the LSM engine keys it by row id and only
+// uses it for name uniqueness.
+void name_search_init(void);
+void name_search_free(void);
+void name_search_add(const char* name, long loc);
+
+// Bulk load for rebuilding from the table: entries go in unordered and are
+// sorted once by name_search_finish_load, before any other call.
+void name_search_load(const char* name, long loc);
+void name_search_finish_load(void);
+// Returns 0 if (name, loc) was not indexed.
+int name_search_remove(const char* name, long loc);
+// Returns 1 if some row is indexed under exactly name.
+int name_search_contains(const char* name);
+// Removes name at loc as part of dropping every entry in [lo, hi), such as
+// a whole partition; call it once per entry there. Each trigram's postings
+// lose the whole range on first sight, so the drop touches only the
+// trigrams of the names dropped, once each.
+void name_search_drop(const char* name, long loc, long lo, long hi);
+
+// Collects candidate locations, sorted ascending, for rows whose name may
+// satisfy c. Candidates still need eval_condition. Returns the count, or
+// -1 if the index cannot narrow c. The caller frees *locs.
+int name_search_candidates(const Condition* c, long** locs);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include "db.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Slotted page for heap rows. The slot directory grows up from the front
+// of the body and records grow down from its end. A record is the row's
+// id and age followed by the name bytes without a terminator; its slot
+// holds the offset and length. Each slot's state takes two bits of a
+// packed bitmap in the page header.
+#define PAGE_SIZE 4096
+#define PAGE_SLOT_BITS 9
+#define PAGE_MAX_SLOTS (1 << PAGE_SLOT_BITS)
+#define PAGE_BODY (PAGE_SIZE - 4 - PAGE_MAX_SLOTS / 4)
+
+// A row id names a slot, the page number above the slot number. It stays
+// the same for the life of the row, even if an update moves the record.
+#define MAKE_RID(page, slot) (((long)(page) << PAGE_SLOT_BITS) | (long)(slot))
+#define RID_PAGE(rid) ((int)((rid) >> PAGE_SLOT_BITS))
+#define RID_SLOT(rid) ((int)((rid) & (PAGE_MAX_SLOTS - 1)))
+
+typedef enum {
+    SLOT_LIVE,
+    SLOT_DELETED,  // tombstone; the slot number is never handed out again
+    SLOT_FORWARD,  // record outgrew its page; holds the row id it moved to
+    SLOT_MOVED     // relocated record, reached only through its home slot
+} SlotState;
+
+typedef struct {
+    uint16_t slot_count;
+    uint16_t data_start;                // records occupy [data_start, PAGE_BODY)
+    uint8_t state[PAGE_MAX_SLOTS / 4];  // SlotState, four slots to a byte
+    uint8_t body[PAGE_BODY];
+} Page;
+
+void page_init(Page* p);
+SlotState page_state(const Page* p, int slot);
+void page_set_state(Page* p, int slot, SlotState state);
+
+// The record encoding on its own: id and age, then the name bytes.
+int page_record_len(const Row* r);
+void page_encode(const Row* r, uint8_t* rec);
+void page_decode(const uint8_t* rec, int len, Row* out);
+
+// Decodes a LIVE or MOVED slot.
+void page_read(const Page* p, int slot, Row* out);
+// Row id a FORWARD slot points to, within the same partition.
+long page_target(const Page* p, int slot);
+
+// Stores r in a new slot; returns the slot, or -1 if the page is full.
+int page_add(Page* p, const Row* r, SlotState state);
+// Replaces the record in slot, compacting the page if it has to. Returns 0,
+// leaving the row as it was, if the record no longer fits on this page.
+int page_put(Page* p, int slot, const Row* r);
+// Turns slot into a FORWARD to target, stored as 64 bits; it always fits
+// where the record was, since every record is at least that long.
+void page_put_forward(Page* p, int slot, long target);
+
+// Rows held in memory in bulk (cached results, parallel scan output) are
+// kept in the record encoding, each behind a 16-bit length, rather than as
+// NAME_SIZE-wide Rows.
+typedef struct {
+    uint8_t* data;
+    size_t used;
+    size_t capacity;
+} RecordBuffer;
+
+// Appends r, never letting the buffer grow past limit bytes (0 for no
+// limit); returns 0, leaving b as it was, if r does not fit under it.
+int record_buffer_add(RecordBuffer* b, const Row* r, size_t limit);
+// Decodes the row at *pos and moves *pos past it; returns 0 at the end.
+int record_buffer_next(const RecordBuffer* b, size_t* pos, Row* out);
+void record_buffer_free(RecordBuffer* b);
+
+#endif
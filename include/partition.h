@@ -0,0 +1,48 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "db.h"
+#include <stdio.h>
+
+#define PARTITION_META_FILE "rows.parts"
+#define PARTITION_FILE_FMT "rows.%d.db"
+#define PARTITION_SCAN_THREADS 8
+
+// A row location packs the partition number above the row's (page, slot)
+// id in its file (see page.h), so indexes and scan callbacks keep passing
+// one long. The transaction write set uses the same packing with a page's
+// byte offset in place of the row id. In single-file mode everything lives
+// in partition 0, which is DB_FILE, and a location is the plain row id.
+#define LOC_SHIFT 40
+#define MAKE_LOC(part, offset) (((long)(part) << LOC_SHIFT) | (long)(offset))
+#define LOC_PART(loc) ((int)((loc) >> LOC_SHIFT))
+#define LOC_OFFSET(loc) ((loc) & ((1L << LOC_SHIFT) - 1))
+
+// rows_per_partition only applies to a new table; an existing table keeps
+// the layout recorded in PARTITION_META_FILE. 0 means a single DB_FILE.
+void partition_init(int rows_per_partition);
+void partition_free(void);
+
+int partition_rows(void);
+int partition_count(void);   // one past the highest partition number
+int partition_exists(int part);
+int partition_active(void);  // partition receiving inserts, -1 if none yet
+int partition_for_id(int id);
+int partition_first_id(int part);
+
+void partition_add(int part);
+int partition_drop(int part);
+// Removes trailing partitions that hold no rows, such as one started inside
+// a transaction that rolled back, so ids continue from the last real row.
+void partition_trim_empty(void);
+// Rereads every cached header from disk, dropping changes a rolled-back
+// transaction made to them.
+void partition_reload_headers(void);
+void partition_path(int part, char* buf, size_t size);
+FILE* partition_open(int part, const char* mode);
+DbHeader* partition_header(int part);
+
+// Returns 0 only if no row in part can satisfy conds, judged by id range.
+int partition_may_match(int part, ConditionList* conds);
+
+#endif
@@ -10,5 +10,8 @@ int eval_condition_list(Row* r, ConditionList* conds);
 typedef void (*RowCallback)(Row* r, long offset, FILE* f);
 
 void scan_rows(ConditionList* conds, RowCallback callback);
+// Heap engine only: scans rows at or after location start (see partition.h),
+// skipping partitions whose id range cannot match conds.
+void scan_rows_from(ConditionList* conds, long start, RowCallback callback);
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef TXN_H
+#define TXN_H
+
+#include "db.h"
+#include "page.h"
+#include <stdio.h>
+
+#define TXN_JOURNAL_FILE DB_FILE ".journal"
+#define TXN_JOURNAL_MAGIC 0x54584e32  // "TXN2", written last to mark a complete journal
+
+int txn_active(void);
+void txn_begin(void);
+void txn_end(void);
+
+// Buffers a page image for a location, a partition and the page's byte
+// offset in its file (see partition.h); later writes to the same location
+// replace it.
+void txn_write(long loc, const Page* page);
+int txn_read(long loc, Page* out);
+
+// Partition headers are buffered the same way until commit.
+void txn_write_header(int part, const DbHeader* header);
+int txn_read_header(int part, DbHeader* out);
+
+// Journals the write set, then applies it partition by partition in
+// location order with contiguous pages coalesced into single writes.
+// Returns 0 if the journal could not be made durable, in which case no
+// data file was touched. If applying a durable journal fails, the process
+// exits so that txn_recover redoes the commit before anything else writes.
+int txn_commit(void);
+
+// Re-applies a complete journal left behind by a crash during commit.
+// Needs partition_init to have run.
+void txn_recover(void);
+
+#endif
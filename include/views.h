@@ -0,0 +1,33 @@
+#ifndef VIEWS_H
+#define VIEWS_H
+
+#include "db.h"
+
+#define VIEW_FILE "views.db"
+#define VIEW_TMP_FILE VIEW_FILE ".tmp"
+#define VIEW_MAGIC 0x56494532  // "VIE2"; bump whenever ViewHeader's layout changes
+#define MAX_VIEWS 16
+#define VIEW_MAX_CONDS 16
+
+// Loads definitions and their aggregates. A file left dirty by a process
+// that did not close cleanly is recomputed from a scan.
+void views_open(void);
+void views_close(void);
+
+// Returns 0 with a message printed if the view cannot be created.
+int views_create(const ViewSpec* spec, ConditionList* conds);
+int views_drop(const char* name);
+int views_print(const char* name);
+void views_rebuild(void);
+
+// Delta hooks, called after the row change has been written.
+void views_on_insert(const Row* row);
+void views_on_delete(const Row* row);
+void views_on_update(const Row* before, const Row* after);
+
+// Transactions apply deltas as they go; rollback puts the aggregates back.
+void views_save_point(void);
+void views_restore_point(void);
+void views_release_point(void);
+
+#endif
@@ -3,6 +3,13 @@
 
 #include "db.h"
 
-ConditionList parse_where_clause(char* input);
+#define WHERE_MAX_TERMS 16
+
+// Fills c from one "field op value" triple; returns 0 if a token is missing.
+int parse_condition(const char* field, const char* op, const char* value, Condition* c);
+// Parses terms joined by and/or, at most WHERE_MAX_TERMS of them. A NULL
+// input continues a strtok split already under way. If stop is given it is
+// left at the first token the clause did not take, or NULL at the end.
+ConditionList parse_where_clause(char* input, char** stop);
 
 #endif
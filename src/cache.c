@@ -0,0 +1,154 @@
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_MAX_TERMS 16
+
+static CachedResult* entries[CACHE_MAX_ENTRIES];
+static int entry_count;
+static unsigned long generation;
+static unsigned long tick;
+static CacheStats stats;
+
+void cache_bump_generation(void) {
+    generation++;
+}
+
+static size_t entry_bytes(const CachedResult* res) {
+    return sizeof(CachedResult) + res->rows.capacity;
+}
+
+static int compare_terms(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+// Builds a canonical key: a run of only ANDs or only ORs is order
+// independent, so its terms are sorted before joining. Names carry their
+// length, so quotes or separators inside one cannot mimic other terms.
+static int normalize(ConditionList* conds, char* key) {
+    if (conds->cond_count > CACHE_MAX_TERMS) return 0;
+
+    char terms[CACHE_MAX_TERMS][NAME_SIZE + 48];
+    for (int i = 0; i < conds->cond_count; i++) {
+        Condition* c = &conds->conds[i];
+        if (c->field == FIELD_NAME)
+            snprintf(terms[i], sizeof(terms[i]), "%d%d#%zu'%s'", c->field, c->op,
+                     strlen(c->str_value), c->str_value);
+        else
+            snprintf(terms[i], sizeof(terms[i]), "%d%d%d", c->field, c->op, c->int_value);
+    }
+
+    int uniform = 1;
+    for (int i = 1; i < conds->op_count; i++) {
+        if (conds->ops[i] != conds->ops[0]) uniform = 0;
+    }
+    if (uniform) qsort(terms, conds->cond_count, sizeof(terms[0]), compare_terms);
+
+    size_t len = 0;
+    key[0] = '\0';
+    for (int i = 0; i < conds->cond_count; i++) {
+        const char* join = "";
+        if (i > 0) join = conds->ops[uniform ? 0 : i - 1] == LOGICAL_AND ? "&" : "|";
+        int n = snprintf(key + len, CACHE_KEY_SIZE - len, "%s%s", join, terms[i]);
+        if (n < 0 || len + n >= CACHE_KEY_SIZE) return 0;
+        len += n;
+    }
+    return 1;
+}
+
+static void free_entry(int i) {
+    stats.bytes -= entry_bytes(entries[i]);
+    record_buffer_free(&entries[i]->rows);
+    free(entries[i]);
+    entries[i] = entries[--entry_count];
+}
+
+CachedResult* cache_lookup(ConditionList* conds, long frontier) {
+    char key[CACHE_KEY_SIZE];
+    if (!normalize(conds, key)) {
+        stats.misses++;
+        return NULL;
+    }
+
+    for (int i = 0; i < entry_count; i++) {
+        if (strcmp(entries[i]->key, key) != 0) continue;
+
+        if (entries[i]->generation != generation) {
+            free_entry(i);
+            stats.invalidations++;
+            break;
+        }
+        entries[i]->last_used = ++tick;
+        if (entries[i]->uncacheable) {
+            stats.misses++;
+            return entries[i];
+        }
+        stats.hits++;
+        if (entries[i]->frontier < frontier) stats.extensions++;
+        return entries[i];
+    }
+
+    stats.misses++;
+    return NULL;
+}
+
+CachedResult* cache_insert(ConditionList* conds) {
+    char key[CACHE_KEY_SIZE];
+    if (!normalize(conds, key)) return NULL;
+
+    if (entry_count >= CACHE_MAX_ENTRIES) {
+        int oldest = 0;
+        for (int i = 1; i < entry_count; i++) {
+            if (entries[i]->last_used < entries[oldest]->last_used) oldest = i;
+        }
+        free_entry(oldest);
+        stats.evictions++;
+    }
+
+    CachedResult* res = calloc(1, sizeof(CachedResult));
+    if (!res) return NULL;
+    memcpy(res->key, key, sizeof(key));
+    res->generation = generation;
+    res->last_used = ++tick;
+
+    entries[entry_count++] = res;
+    stats.bytes += entry_bytes(res);
+    return res;
+}
+
+int cache_append(CachedResult* res, const Row* row) {
+    if (res->uncacheable) return 0;
+
+    stats.bytes -= entry_bytes(res);
+    if (record_buffer_add(&res->rows, row, CACHE_MAX_BYTES - sizeof(CachedResult))) {
+        res->size++;
+    } else {
+        record_buffer_free(&res->rows);
+        res->size = 0;
+        res->uncacheable = 1;
+    }
+    stats.bytes += entry_bytes(res);
+    return !res->uncacheable;
+}
+
+void cache_trim(void) {
+    while (entry_count > 0 && stats.bytes > CACHE_MAX_BYTES) {
+        int oldest = 0;
+        for (int i = 1; i < entry_count; i++) {
+            if (entries[i]->last_used < entries[oldest]->last_used) oldest = i;
+        }
+        free_entry(oldest);
+        stats.evictions++;
+    }
+}
+
+void cache_clear(void) {
+    while (entry_count > 0) free_entry(0);
+}
+
+CacheStats cache_stats(void) {
+    CacheStats s = stats;
+    s.entries = entry_count;
+    return s;
+}
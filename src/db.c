@@ -1,102 +1,299 @@
 #include "db.h"
+#include "cache.h"
+#include "heap.h"
 #include "index.h"
+#include "lsm.h"
+#include "name_search.h"
+#include "partition.h"
 #include "query.h"
+#include "txn.h"
+#include "views.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static DbHeader header;
-static Index id_index;
-static Index name_index;
+static StorageEngine engine;
+static Index* id_indexes;  // heap only: one per partition, grown as ids reach it
+static int id_index_count;
 static const Row* update_values;
+static CachedResult* filling;
 
-DbHeader* get_header(void) {
-    return &header;
+StorageEngine get_engine(void) {
+    return engine;
 }
 
-void load_header(FILE* f) {
-    fseek(f, 0, SEEK_SET);
-    if (fread(&header, sizeof(DbHeader), 1, f) != 1) {
-        // if empty file, init
-        header.num_rows = 0;
-        header.next_id = 1;
-        fseek(f, 0, SEEK_SET);
-        fwrite(&header, sizeof(DbHeader), 1, f);
-        fflush(f);
+static void index_lsm_row(Row* r, long offset, FILE* f) {
+    (void)offset;
+    (void)f;
+    name_search_load(r->name, r->id);
+}
+
+// Index for the partition id falls in, creating those up to it. Each
+// partition keeps its own ids, so a lookup searches only its partition's
+// rows and a dropped partition's index is freed whole.
+static Index* id_index_for(int id) {
+    int part = partition_for_id(id);
+    if (part >= id_index_count) {
+        id_indexes = realloc(id_indexes, sizeof(Index) * (part + 1));
+        if (!id_indexes) { perror("realloc"); exit(1); }
+        for (int i = id_index_count; i <= part; i++) index_init(&id_indexes[i], INDEX_INT, FIELD_ID, 16);
+        id_index_count = part + 1;
     }
+    return &id_indexes[part];
 }
 
-static void save_header(FILE* f) {
-    fseek(f, 0, SEEK_SET);
-    fwrite(&header, sizeof(DbHeader), 1, f);
-    fflush(f);
+static long find_id(int id) {
+    int part = partition_for_id(id);
+    if (part < 0 || part >= id_index_count) return -1;
+    return index_find(&id_indexes[part], &id);
 }
 
-void db_init() {
-    index_init(&id_index, INDEX_INT, FIELD_ID, 16);
-    index_init(&name_index, INDEX_STRING, FIELD_NAME, 16);
+static void load_indexes(void) {
+    name_search_init();
 
-    FILE* f = fopen(DB_FILE, "rb");
-    if (!f) return;
+    // the LSM engine keeps only the name search, for uniqueness checks; it
+    // maps to the row id since LSM rows have no stable location
+    if (engine == ENGINE_LSM) {
+        ConditionList all = {0};
+        lsm_scan(&all, index_lsm_row);
+        name_search_finish_load();
+        return;
+    }
 
-    load_header(f);
+    for (int part = 0; part < partition_count(); part++) {
+        if (!partition_exists(part)) continue;
+        FILE* f = partition_open(part, "rb");
+        if (!f) continue;
 
-    Row r;
-    for (int i = 0; i < header.num_rows; i++) {
-        long offset = sizeof(DbHeader) + i * sizeof(Row);
-        fseek(f, offset, SEEK_SET);
-        fread(&r, sizeof(Row), 1, f);
-        if (!r.is_deleted) {
-            index_add(&id_index, &r.id, offset);
+        heap_load_header(f, part);
+
+        HeapCursor c;
+        Row r;
+        long loc;
+        heap_cursor_open(&c, f, part, 0);
+        while (heap_cursor_next(&c, &r, &loc)) {
+            index_add(id_index_for(r.id), &r.id, loc);
+            name_search_load(r.name, loc);
         }
+        fclose(f);
     }
-    fclose(f);
+    name_search_finish_load();
 }
 
-void db_insert(Row* row) {
-    FILE* f = fopen(DB_FILE, "r+b");
-    if (!f) {
-        f = fopen(DB_FILE, "w+b");
-        if (!f) { perror("fopen"); exit(1); }
+static void free_indexes(void) {
+    for (int i = 0; i < id_index_count; i++) index_free(&id_indexes[i]);
+    free(id_indexes);
+    id_indexes = NULL;
+    id_index_count = 0;
+    name_search_free();
+}
+
+static int file_exists(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f) fclose(f);
+    return f != NULL;
+}
+
+// The engine is fixed when a table is created and recorded in ENGINE_FILE;
+// tables from before that are recognised by their files.
+static StorageEngine open_engine(const DbOptions* options) {
+    StorageEngine stored = options->engine;
+    int known = 0;
+
+    FILE* f = fopen(ENGINE_FILE, "rb");
+    int recorded = f != NULL;
+    if (recorded) {
+        known = fread(&stored, sizeof(StorageEngine), 1, f) == 1 &&
+                (stored == ENGINE_HEAP || stored == ENGINE_LSM);
+        fclose(f);
+        if (!known) {
+            fprintf(stderr, "db: %s is corrupt\n", ENGINE_FILE);
+            exit(1);
+        }
+    } else if (file_exists(LSM_MANIFEST_FILE) || file_exists(LSM_WAL_FILE)) {
+        stored = ENGINE_LSM;
+        known = 1;
+    } else if (file_exists(DB_FILE) || file_exists(PARTITION_META_FILE)) {
+        stored = ENGINE_HEAP;
+        known = 1;
     }
 
-    load_header(f);
+    if (known && options->engine_given && stored != options->engine) {
+        fprintf(stderr, "db: the table here uses the %s engine; pass --engine=%s or use another directory\n",
+                stored == ENGINE_LSM ? "lsm" : "heap", stored == ENGINE_LSM ? "lsm" : "heap");
+        exit(1);
+    }
 
-    row->id = header.next_id++;
-    row->is_deleted = 0;
+    if (!recorded) {
+        f = fopen(ENGINE_FILE, "wb");
+        if (!f || fwrite(&stored, sizeof(StorageEngine), 1, f) != 1) { perror(ENGINE_FILE); exit(1); }
+        fclose(f);
+    }
+    return stored;
+}
 
-    long offset = sizeof(DbHeader) + header.num_rows * sizeof(Row);
+void db_init(const DbOptions* options) {
+    engine = open_engine(options);
 
-    fseek(f, offset, SEEK_SET);
-    fwrite(row, sizeof(Row), 1, f);
-    fflush(f);
+    if (engine == ENGINE_LSM) {
+        lsm_open();
+    } else {
+        partition_init(options->partition_rows);
+        txn_recover();
 
-    header.num_rows++;
-    save_header(f);
+        // tables written before slotted pages are rewritten once, here
+        int converted = 0;
+        for (int part = 0; part < partition_count(); part++) {
+            if (partition_exists(part)) converted |= heap_convert_legacy(part);
+        }
+        if (converted) partition_reload_headers();
+    }
 
-    index_add(&id_index, &row->id, offset);
-    index_add(&name_index, row->name, offset);
+    load_indexes();
+    views_open();
+}
 
-    fclose(f);
+void db_close() {
+    if (txn_active()) {
+        printf("Rolling back open transaction.\n");
+        db_rollback();
+    }
+    views_close();
+    if (engine == ENGINE_LSM) lsm_close();
+    else partition_free();
+    cache_clear();
+    free_indexes();
 }
 
-void db_select_all() {
-    FILE* f = fopen(DB_FILE, "rb");
-    if (!f) { perror("fopen"); return; }
+// Index changes made inside a transaction, undone newest first when it
+// rolls back so the indexes never have to be rebuilt from the table.
+typedef enum { UNDO_ADD, UNDO_REMOVE } UndoOp;
+
+typedef struct {
+    UndoOp op;
+    int id;
+    char* name;  // NULL for an id index entry, else a name_search one
+    long loc;
+} IndexUndo;
+
+static IndexUndo* undo_log;
+static int undo_size;
+static int undo_capacity;
+
+static void undo_push(UndoOp op, int id, const char* name, long loc) {
+    if (!txn_active()) return;
+    if (undo_size >= undo_capacity) {
+        undo_capacity = undo_capacity ? undo_capacity * 2 : 64;
+        undo_log = realloc(undo_log, sizeof(IndexUndo) * undo_capacity);
+        if (!undo_log) { perror("realloc"); exit(1); }
+    }
+    IndexUndo* u = &undo_log[undo_size++];
+    u->op = op;
+    u->id = id;
+    u->name = name ? strdup(name) : NULL;
+    u->loc = loc;
+}
 
-    load_header(f);
+static void forget_index_changes(void) {
+    for (int i = 0; i < undo_size; i++) free(undo_log[i].name);
+    free(undo_log);
+    undo_log = NULL;
+    undo_size = undo_capacity = 0;
+}
 
-    Row r;
-    for (int i = 0; i < header.num_rows; i++) {
+static void undo_index_changes(void) {
+    for (int i = undo_size - 1; i >= 0; i--) {
+        IndexUndo* u = &undo_log[i];
+        if (u->name) {
+            if (u->op == UNDO_ADD) name_search_remove(u->name, u->loc);
+            else name_search_add(u->name, u->loc);
+        } else if (u->op == UNDO_ADD) {
+            index_remove(id_index_for(u->id), &u->id);
+        } else {
+            index_add(id_index_for(u->id), &u->id, u->loc);
+        }
+    }
+    forget_index_changes();
+}
 
-        fseek(f, sizeof(DbHeader) + i * sizeof(Row), SEEK_SET);
-        fread(&r, sizeof(Row), 1, f);
+static void track_id_add(int id, long loc) {
+    index_add(id_index_for(id), &id, loc);
+    undo_push(UNDO_ADD, id, NULL, loc);
+}
 
-        if (!r.is_deleted) {
-            printf("Row: id=%d, name=%s, age=%d\n", r.id, r.name, r.age);
-        }
+static void track_id_remove(int id) {
+    long loc = find_id(id);
+    if (loc == -1) return;
+    index_remove(id_index_for(id), &id);
+    undo_push(UNDO_REMOVE, id, NULL, loc);
+}
+
+static void track_search_add(const char* name, long loc) {
+    name_search_add(name, loc);
+    undo_push(UNDO_ADD, 0, name, loc);
+}
+
+static void track_search_remove(const char* name, long loc) {
+    if (name_search_remove(name, loc)) undo_push(UNDO_REMOVE, 0, name, loc);
+}
+
+// Names past LSM_NAME_SIZE fit the heap's pages but not LSM's fixed rows.
+static int lsm_name_fits(const char* name) {
+    if (strlen(name) < LSM_NAME_SIZE) return 1;
+    printf("Error: the LSM engine stores names up to %d characters.\n", LSM_NAME_SIZE - 1);
+    return 0;
+}
+
+int db_insert(Row* row) {
+    if (engine == ENGINE_LSM) {
+        if (!lsm_name_fits(row->name)) return 0;
+        row->id = lsm_next_id();
+        row->is_deleted = 0;
+        lsm_put(row);
+        track_search_add(row->name, row->id);
+        views_on_insert(row);
+        // LSM scans return rows by id, not append order, so no tail to extend
+        cache_bump_generation();
+        return 1;
     }
+
+    int part = partition_active();
+    FILE* f = NULL;
+    int id = 1;
+    if (part >= 0) {
+        f = partition_open(part, "r+b");
+        if (!f) { perror("fopen"); exit(1); }
+        heap_load_header(f, part);
+        id = partition_header(part)->next_id;
+    }
+
+    // the next id can fall past the active partition's range; start a new one
+    if (part < 0 || partition_for_id(id) != part) {
+        if (f) fclose(f);
+        part = partition_for_id(id);
+        partition_add(part);
+        f = partition_open(part, "w+b");
+        if (!f) { perror("fopen"); exit(1); }
+
+        // written straight through, even in a transaction, so reads have a base
+        DbHeader* fresh = partition_header(part);
+        *fresh = (DbHeader){ DB_MAGIC, 0, id, 0 };
+        fwrite(fresh, sizeof(DbHeader), 1, f);
+        fflush(f);
+    }
+
+    DbHeader* header = partition_header(part);
+    row->id = header->next_id++;
+    row->is_deleted = 0;
+
+    long loc = heap_insert(f, part, row);
+
+    track_id_add(row->id, loc);
+    track_search_add(row->name, loc);
+    views_on_insert(row);
+
     fclose(f);
+    return 1;
 }
 
 static void print_row(Row* r, long offset, FILE* f) {
@@ -105,76 +302,209 @@ static void print_row(Row* r, long offset, FILE* f) {
     printf("Row: id=%d, name=%s, age=%d\n", r->id, r->name, r->age);
 }
 
+void db_select_all() {
+    if (engine == ENGINE_LSM) {
+        ConditionList all = {0};
+        lsm_scan(&all, print_row);
+        return;
+    }
+
+    for (int part = 0; part < partition_count(); part++) {
+        if (!partition_exists(part)) continue;
+        FILE* f = partition_open(part, "rb");
+        if (!f) { perror("fopen"); return; }
+
+        heap_load_header(f, part);
+
+        HeapCursor c;
+        Row r;
+        long loc;
+        heap_cursor_open(&c, f, part, 0);
+        while (heap_cursor_next(&c, &r, &loc)) {
+            printf("Row: id=%d, name=%s, age=%d\n", r.id, r.name, r.age);
+        }
+        fclose(f);
+    }
+}
+
+// Prints each match as the scan finds it, keeping a copy while the result
+// still fits the cache.
+static void fill_result(Row* r, long offset, FILE* f) {
+    print_row(r, offset, f);
+    if (filling && !cache_append(filling, r)) filling = NULL;
+}
+
+// Location just past the last appended heap row; cached results remember
+// it so later hits only rescan what was appended after.
+static long append_frontier(void) {
+    int part = partition_active();
+    if (engine == ENGINE_LSM || part < 0) return 0;
+    return heap_end(part);
+}
+
 void db_select_where(ConditionList* conds) {
-    scan_rows(conds, print_row);
+    // an open transaction sees its own uncommitted rows; keep them out of the cache
+    if (txn_active()) {
+        scan_rows(conds, print_row);
+        return;
+    }
+
+    long frontier = append_frontier();
+    CachedResult* res = cache_lookup(conds, frontier);
+    if (res && res->uncacheable) {
+        scan_rows(conds, print_row);
+        return;
+    }
+    if (!res) {
+        res = cache_insert(conds);
+        if (!res) {
+            scan_rows(conds, print_row);
+            return;
+        }
+        filling = res;
+        scan_rows(conds, fill_result);
+        res->frontier = frontier;
+        filling = NULL;
+        cache_trim();
+        return;
+    }
+
+    Row r;
+    size_t pos = 0;
+    while (record_buffer_next(&res->rows, &pos, &r)) {
+        print_row(&r, -1, NULL);
+    }
+    if (engine == ENGINE_HEAP && res->frontier < frontier) {
+        // only appends happened since; match just the new rows
+        filling = res;
+        scan_rows_from(conds, res->frontier, fill_result);
+        res->frontier = frontier;
+        filling = NULL;
+    }
+    cache_trim();
+}
+
+void db_cache_stats() {
+    CacheStats s = cache_stats();
+    long lookups = s.hits + s.misses;
+    printf("Cache: %d entries, %zu bytes (cap %d)\n", s.entries, s.bytes, CACHE_MAX_BYTES);
+    printf("hits=%ld misses=%ld hit_rate=%.1f%% extensions=%ld invalidations=%ld evictions=%ld\n",
+           s.hits, s.misses, lookups ? 100.0 * s.hits / lookups : 0.0,
+           s.extensions, s.invalidations, s.evictions);
 }
 
 static void update_row(Row* r, long offset, FILE* f) {
-    index_remove(&id_index, &r->id);
-    index_remove(&name_index, r->name);
+    Row before = *r;
+    cache_bump_generation();
+    track_id_remove(r->id);
+    track_search_remove(r->name, engine == ENGINE_LSM ? r->id : offset);
 
     if (update_values->age != -1) r->age = update_values->age;
     if (update_values->name[0] != '\0')
         strncpy(r->name, update_values->name, sizeof(r->name));
 
-    fseek(f, offset, SEEK_SET);
-    fwrite(r, sizeof(Row), 1, f);
-    fflush(f);
+    if (engine == ENGINE_LSM) {
+        lsm_put(r);
+        track_search_add(r->name, r->id);
+        views_on_update(&before, r);
+        return;
+    }
+
+    heap_update(f, offset, r);
 
-    index_add(&id_index, &r->id, offset);
-    index_add(&name_index, r->name, offset);
+    track_id_add(r->id, offset);
+    track_search_add(r->name, offset);
+    views_on_update(&before, r);
 }
 
 void db_update_where(ConditionList* conds, const Row* new_values) {
+    if (engine == ENGINE_LSM && !lsm_name_fits(new_values->name)) return;
+
     update_values = new_values;
     scan_rows(conds, update_row);
     printf("Updated matching rows.\n");
 }
 
-void db_update_by_id(int id, const char* new_name, int new_age) {
-    FILE* f = fopen(DB_FILE, "r+b");
-    if (!f) { perror("fopen"); return; }
-
-    load_header(f);
+static void lsm_update_by_id(int id, const char* new_name, int new_age) {
+    if (!lsm_name_fits(new_name)) return;
 
     Row r;
-    for (int i = 0; i < header.num_rows; i++) {
-        fseek(f, sizeof(DbHeader) + i * sizeof(Row), SEEK_SET);
-        fread(&r, sizeof(Row), 1, f);
-
-        if (r.id == id && !r.is_deleted) {
-            if (strcmp(r.name, new_name) != 0 &&
-                index_find(&name_index, new_name) != -1) {
-                printf("Error: name '%s' already exists. Update rejected.\n", new_name);
-                fclose(f);
-                return;
-            }
+    if (!lsm_get(id, &r)) {
+        printf("Row with id=%d not found or deleted.\n", id);
+        return;
+    }
 
-            strncpy(r.name, new_name, sizeof(r.name));
-            r.age = new_age;
+    if (strcmp(r.name, new_name) != 0 &&
+        name_search_contains(new_name)) {
+        printf("Error: name '%s' already exists. Update rejected.\n", new_name);
+        return;
+    }
 
-            fseek(f, sizeof(DbHeader) + i * sizeof(Row), SEEK_SET);
-            fwrite(&r, sizeof(Row), 1, f);
-            fflush(f);
+    Row before = r;
+    track_search_remove(r.name, r.id);
+    strncpy(r.name, new_name, sizeof(r.name));
+    r.age = new_age;
+    lsm_put(&r);
+    cache_bump_generation();
+    track_search_add(r.name, r.id);
+    views_on_update(&before, &r);
 
-            printf("Updated row with id=%d\n", id);
-            fclose(f);
-            return;
-        }
+    printf("Updated row with id=%d\n", id);
+}
+
+void db_update_by_id(int id, const char* new_name, int new_age) {
+    if (engine == ENGINE_LSM) {
+        lsm_update_by_id(id, new_name, new_age);
+        return;
     }
 
-    printf("Row with id=%d not found or deleted.\n", id);
+    long loc = find_id(id);
+    FILE* f = loc != -1 ? partition_open(LOC_PART(loc), "r+b") : NULL;
+    Row r;
+    if (!f || !heap_read_row(f, loc, &r)) {
+        printf("Row with id=%d not found or deleted.\n", id);
+        if (f) fclose(f);
+        return;
+    }
+    heap_load_header(f, LOC_PART(loc));
+
+    if (strcmp(r.name, new_name) != 0 &&
+        name_search_contains(new_name)) {
+        printf("Error: name '%s' already exists. Update rejected.\n", new_name);
+        fclose(f);
+        return;
+    }
+
+    Row before = r;
+    track_search_remove(r.name, loc);
+
+    strncpy(r.name, new_name, sizeof(r.name));
+    r.age = new_age;
+
+    heap_update(f, loc, &r);
+    cache_bump_generation();
+    track_search_add(r.name, loc);
+    views_on_update(&before, &r);
+
+    printf("Updated row with id=%d\n", id);
     fclose(f);
 }
 
 static void delete_row(Row* r, long offset, FILE* f) {
+    cache_bump_generation();
     r->is_deleted = 1;
-    fseek(f, offset, SEEK_SET);
-    fwrite(r, sizeof(Row), 1, f);
-    fflush(f);
+    if (engine == ENGINE_LSM) {
+        lsm_put(r);
+        track_search_remove(r->name, r->id);
+        views_on_delete(r);
+        return;
+    }
+
+    heap_delete(f, offset);
 
-    index_remove(&id_index, &r->id);
-    index_remove(&name_index, r->name);
+    track_id_remove(r->id);
+    track_search_remove(r->name, offset);
+    views_on_delete(r);
 }
 
 void db_delete_where(ConditionList* conds) {
@@ -183,31 +513,182 @@ void db_delete_where(ConditionList* conds) {
 }
 
 void db_delete_by_id(int id) {
-    FILE* f = fopen(DB_FILE, "r+b");
-    if (!f) { perror("fopen"); return; }
-
-    load_header(f);
+    if (engine == ENGINE_LSM) {
+        Row r;
+        if (!lsm_get(id, &r)) {
+            printf("Row with id=%d not found or already deleted.\n", id);
+            return;
+        }
+        r.is_deleted = 1;
+        lsm_put(&r);
+        cache_bump_generation();
+        track_search_remove(r.name, r.id);
+        views_on_delete(&r);
+        printf("Deleted row with id=%d\n", id);
+        return;
+    }
 
+    long loc = find_id(id);
+    FILE* f = loc != -1 ? partition_open(LOC_PART(loc), "r+b") : NULL;
     Row r;
-    for (int i = 0; i < header.num_rows; i++) {
-        fseek(f, sizeof(DbHeader) + i * sizeof(Row), SEEK_SET);
-        fread(&r, sizeof(Row), 1, f);
+    if (!f || !heap_read_row(f, loc, &r)) {
+        printf("Row with id=%d not found or already deleted.\n", id);
+        if (f) fclose(f);
+        return;
+    }
 
-        if (r.id == id && r.is_deleted == 0) {
-            r.is_deleted = 1;
-            fseek(f, sizeof(DbHeader) + i * sizeof(Row), SEEK_SET);
-            fwrite(&r, sizeof(Row), 1, f);
-            fflush(f);
+    heap_delete(f, loc);
+    cache_bump_generation();
 
-            index_remove(&id_index, &r.id);
-            index_remove(&name_index, r.name);
+    track_id_remove(r.id);
+    track_search_remove(r.name, loc);
+    views_on_delete(&r);
 
-            printf("Deleted row with id=%d\n", id);
-            fclose(f);
-            return;
+    printf("Deleted row with id=%d\n", id);
+    fclose(f);
+}
+
+void db_begin() {
+    if (txn_active()) {
+        printf("Error: transaction already open.\n");
+        return;
+    }
+
+    txn_begin();
+    views_save_point();
+    printf("Transaction started.\n");
+}
+
+// Drops the open transaction's writes and the in-memory state built on them.
+static void discard_transaction(void) {
+    if (engine == ENGINE_LSM) lsm_rollback();
+    txn_end();
+    undo_index_changes();
+    views_restore_point();
+    if (engine == ENGINE_HEAP) {
+        // headers and the append frontier cached results extend from go back
+        // to what is on disk
+        partition_reload_headers();
+        partition_trim_empty();
+    }
+    cache_bump_generation();
+}
+
+void db_commit() {
+    if (!txn_active()) {
+        printf("Error: no open transaction.\n");
+        return;
+    }
+
+    int ok = engine == ENGINE_LSM ? lsm_commit() : txn_commit();
+    if (!ok) {
+        discard_transaction();
+        printf("Error: commit failed, transaction rolled back.\n");
+        return;
+    }
+
+    txn_end();
+    forget_index_changes();
+    views_release_point();
+    printf("Committed.\n");
+}
+
+void db_rollback() {
+    if (!txn_active()) {
+        printf("Error: no open transaction.\n");
+        return;
+    }
+
+    discard_transaction();
+    printf("Rolled back.\n");
+}
+
+void db_drop_partition(int part) {
+    if (engine != ENGINE_HEAP || partition_rows() == 0) {
+        printf("Error: table is not partitioned.\n");
+        return;
+    }
+    if (txn_active()) {
+        printf("Error: cannot drop a partition inside a transaction.\n");
+        return;
+    }
+    if (part == partition_active()) {
+        printf("Error: partition %d is receiving inserts.\n", part);
+        return;
+    }
+    if (!partition_exists(part)) {
+        printf("Partition %d not found.\n", part);
+        return;
+    }
+
+    // take the partition's rows out of the views while they can still be
+    // read, keeping them to take out of name_search once the file is gone
+    RecordBuffer dropped = {0};
+    long* locs = NULL;
+    int count = 0, capacity = 0;
+    FILE* f = partition_open(part, "rb");
+    if (f) {
+        heap_load_header(f, part);
+        HeapCursor c;
+        Row r;
+        long loc;
+        heap_cursor_open(&c, f, part, 0);
+        while (heap_cursor_next(&c, &r, &loc)) {
+            views_on_delete(&r);
+            if (count >= capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                locs = realloc(locs, sizeof(long) * capacity);
+                if (!locs) { perror("realloc"); exit(1); }
+            }
+            record_buffer_add(&dropped, &r, 0);
+            locs[count++] = loc;
         }
+        fclose(f);
     }
 
-    printf("Row with id=%d not found or already deleted.\n", id);
-    fclose(f);
+    if (!partition_drop(part)) {
+        record_buffer_free(&dropped);
+        free(locs);
+        views_rebuild();
+        printf("Error: could not drop partition %d.\n", part);
+        return;
+    }
+
+    cache_bump_generation();
+    if (part < id_index_count) {
+        index_free(&id_indexes[part]);
+        index_init(&id_indexes[part], INDEX_INT, FIELD_ID, 16);
+    }
+
+    long lo = MAKE_LOC(part, 0), hi = MAKE_LOC(part + 1, 0);
+    Row r;
+    size_t pos = 0;
+    for (int i = 0; record_buffer_next(&dropped, &pos, &r); i++) {
+        name_search_drop(r.name, locs[i], lo, hi);
+    }
+    record_buffer_free(&dropped);
+    free(locs);
+    printf("Dropped partition %d (ids %d-%d).\n", part,
+           partition_first_id(part), partition_first_id(part + 1) - 1);
+}
+
+void db_create_view(const ViewSpec* spec, ConditionList* conds) {
+    if (txn_active()) {
+        printf("Error: cannot create a view inside a transaction.\n");
+        return;
+    }
+    if (views_create(spec, conds)) printf("Created view %s.\n", spec->name);
+}
+
+void db_select_view(const char* name) {
+    if (!views_print(name)) printf("View '%s' not found.\n", name);
+}
+
+void db_drop_view(const char* name) {
+    if (txn_active()) {
+        printf("Error: cannot drop a view inside a transaction.\n");
+        return;
+    }
+    if (views_drop(name)) printf("Dropped view %s.\n", name);
+    else printf("View '%s' not found.\n", name);
 }
@@ -0,0 +1,300 @@
+#include "heap.h"
+#include "partition.h"
+#include "txn.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PAGE_LOC(part, page) MAKE_LOC(part, HEAP_PAGE_OFFSET(page))
+
+void heap_load_header(FILE* f, int part) {
+    DbHeader* header = partition_header(part);
+
+    // an open transaction owns the headers it has touched until it ends
+    if (txn_active() && txn_read_header(part, header)) return;
+
+    fseek(f, 0, SEEK_SET);
+    if (fread(header, sizeof(DbHeader), 1, f) != 1) {
+        // if empty file, init
+        header->magic = DB_MAGIC;
+        header->num_pages = 0;
+        header->next_id = partition_first_id(part);
+        header->tail_slots = 0;
+        fseek(f, 0, SEEK_SET);
+        fwrite(header, sizeof(DbHeader), 1, f);
+        fflush(f);
+    } else if (header->magic != DB_MAGIC) {
+        fprintf(stderr, "heap: partition %d is not in the slotted-page format\n", part);
+        exit(1);
+    }
+}
+
+// Layout of partition files before slotted pages: this header, then
+// num_rows fixed-size rows, deleted ones flagged in place.
+typedef struct {
+    int num_rows;
+    int next_id;
+} LegacyHeader;
+
+typedef struct {
+    int id;
+    char name[32];
+    int age;
+    int is_deleted;
+} LegacyRow;
+
+static long file_size(FILE* f) {
+    fseek(f, 0, SEEK_END);
+    return ftell(f);
+}
+
+// Writes the live rows of a fixed-row file into pages in out, keeping their
+// ids. Returns 0 on a short read or write.
+static int convert_rows(FILE* in, const LegacyHeader* old, FILE* out) {
+    DbHeader header = { DB_MAGIC, 0, old->next_id, 0 };
+    if (fwrite(&header, sizeof(DbHeader), 1, out) != 1) return 0;
+
+    Page p;
+    page_init(&p);
+    fseek(in, sizeof(LegacyHeader), SEEK_SET);
+    for (int i = 0; i < old->num_rows; i++) {
+        LegacyRow lr;
+        if (fread(&lr, sizeof(LegacyRow), 1, in) != 1) return 0;
+        if (lr.is_deleted) continue;
+
+        Row r = { .id = lr.id, .age = lr.age };
+        memcpy(r.name, lr.name, sizeof(lr.name));
+        r.name[sizeof(lr.name) - 1] = '\0';
+
+        if (page_add(&p, &r, SLOT_LIVE) < 0) {
+            if (fwrite(&p, sizeof(Page), 1, out) != 1) return 0;
+            header.num_pages++;
+            page_init(&p);
+            page_add(&p, &r, SLOT_LIVE);
+        }
+    }
+    if (p.slot_count > 0) {
+        if (fwrite(&p, sizeof(Page), 1, out) != 1) return 0;
+        header.num_pages++;
+    }
+    header.tail_slots = p.slot_count;
+
+    fseek(out, 0, SEEK_SET);
+    return fwrite(&header, sizeof(DbHeader), 1, out) == 1 &&
+           fflush(out) == 0 && fsync(fileno(out)) == 0;
+}
+
+int heap_convert_legacy(int part) {
+    FILE* f = partition_open(part, "rb");
+    if (!f) return 0;
+
+    // a fixed-row file is exactly its header and rows; anything else is left
+    // for heap_load_header to accept or refuse
+    LegacyHeader old;
+    long size = file_size(f);
+    fseek(f, 0, SEEK_SET);
+    if (fread(&old, sizeof(LegacyHeader), 1, f) != 1 || old.num_rows == DB_MAGIC ||
+        old.num_rows < 0 ||
+        size != (long)sizeof(LegacyHeader) + (long)old.num_rows * (long)sizeof(LegacyRow)) {
+        fclose(f);
+        return 0;
+    }
+
+    char path[64], tmp[80];
+    partition_path(part, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.convert", path);
+
+    // the old file stays until the new one is durable and renamed over it
+    FILE* out = fopen(tmp, "wb");
+    int ok = out && convert_rows(f, &old, out);
+    if (out) fclose(out);
+    fclose(f);
+    ok = ok && rename(tmp, path) == 0;
+
+    int dir = open(".", O_RDONLY);
+    ok = ok && dir >= 0 && fsync(dir) == 0;
+    if (dir >= 0) close(dir);
+
+    if (!ok) {
+        perror(path);
+        remove(tmp);
+        fprintf(stderr, "heap: could not convert %s to the slotted-page format\n", path);
+        exit(1);
+    }
+    fprintf(stderr, "heap: converted %s to the slotted-page format\n", path);
+    return 1;
+}
+
+void heap_save_header(FILE* f, int part) {
+    DbHeader* header = partition_header(part);
+    if (txn_active()) {
+        txn_write_header(part, header);
+        return;
+    }
+
+    fseek(f, 0, SEEK_SET);
+    fwrite(header, sizeof(DbHeader), 1, f);
+    fflush(f);
+}
+
+void heap_read_page(FILE* f, int part, int page, Page* out) {
+    long loc = PAGE_LOC(part, page);
+    if (txn_active() && txn_read(loc, out)) return;
+
+    fseek(f, LOC_OFFSET(loc), SEEK_SET);
+    if (fread(out, sizeof(Page), 1, f) != 1) page_init(out);
+}
+
+static void write_page(FILE* f, int part, int page, const Page* p) {
+    long loc = PAGE_LOC(part, page);
+    if (txn_active()) {
+        txn_write(loc, p);
+        return;
+    }
+
+    fseek(f, LOC_OFFSET(loc), SEEK_SET);
+    fwrite(p, sizeof(Page), 1, f);
+    fflush(f);
+}
+
+int heap_page_row(FILE* f, int part, const Page* p, int slot, Row* out) {
+    switch (page_state(p, slot)) {
+        case SLOT_LIVE:
+            page_read(p, slot, out);
+            return 1;
+        case SLOT_FORWARD: {
+            long target = page_target(p, slot);
+            Page moved;
+            heap_read_page(f, part, RID_PAGE(target), &moved);
+            page_read(&moved, RID_SLOT(target), out);
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+int heap_read_row(FILE* f, long loc, Row* out) {
+    long rid = LOC_OFFSET(loc);
+    Page p;
+    heap_read_page(f, LOC_PART(loc), RID_PAGE(rid), &p);
+    if (RID_SLOT(rid) >= p.slot_count) return 0;
+    return heap_page_row(f, LOC_PART(loc), &p, RID_SLOT(rid), out);
+}
+
+// Adds a record to the last page, starting a new page when it is full,
+// and returns its row id.
+static long append_record(FILE* f, int part, const Row* r, SlotState state) {
+    DbHeader* header = partition_header(part);
+    Page p;
+    int slot = -1;
+    if (header->num_pages > 0) {
+        heap_read_page(f, part, header->num_pages - 1, &p);
+        slot = page_add(&p, r, state);
+    }
+    if (slot < 0) {
+        page_init(&p);
+        header->num_pages++;
+        slot = page_add(&p, r, state);
+    }
+
+    write_page(f, part, header->num_pages - 1, &p);
+    header->tail_slots = p.slot_count;
+    heap_save_header(f, part);
+    return MAKE_RID(header->num_pages - 1, slot);
+}
+
+long heap_insert(FILE* f, int part, const Row* r) {
+    return MAKE_LOC(part, append_record(f, part, r, SLOT_LIVE));
+}
+
+void heap_update(FILE* f, long loc, const Row* r) {
+    int part = LOC_PART(loc);
+    long rid = LOC_OFFSET(loc);
+    int slot = RID_SLOT(rid);
+    Page home;
+    heap_read_page(f, part, RID_PAGE(rid), &home);
+
+    if (page_state(&home, slot) == SLOT_FORWARD) {
+        long target = page_target(&home, slot);
+        Page moved;
+        heap_read_page(f, part, RID_PAGE(target), &moved);
+        if (page_put(&moved, RID_SLOT(target), r)) {
+            write_page(f, part, RID_PAGE(target), &moved);
+            return;
+        }
+        // the old copy goes; the row lands at home or at a new target below
+        page_set_state(&moved, RID_SLOT(target), SLOT_DELETED);
+        write_page(f, part, RID_PAGE(target), &moved);
+    }
+
+    if (page_put(&home, slot, r)) {
+        page_set_state(&home, slot, SLOT_LIVE);
+        write_page(f, part, RID_PAGE(rid), &home);
+        return;
+    }
+
+    // too big for its page: move it and leave a forward behind, so the row
+    // id in every index still resolves
+    long target = append_record(f, part, r, SLOT_MOVED);
+    heap_read_page(f, part, RID_PAGE(rid), &home);
+    page_put_forward(&home, slot, target);
+    write_page(f, part, RID_PAGE(rid), &home);
+}
+
+void heap_delete(FILE* f, long loc) {
+    int part = LOC_PART(loc);
+    long rid = LOC_OFFSET(loc);
+    Page home;
+    heap_read_page(f, part, RID_PAGE(rid), &home);
+
+    if (page_state(&home, RID_SLOT(rid)) == SLOT_FORWARD) {
+        long target = page_target(&home, RID_SLOT(rid));
+        Page moved;
+        heap_read_page(f, part, RID_PAGE(target), &moved);
+        page_set_state(&moved, RID_SLOT(target), SLOT_DELETED);
+        write_page(f, part, RID_PAGE(target), &moved);
+    }
+
+    page_set_state(&home, RID_SLOT(rid), SLOT_DELETED);
+    write_page(f, part, RID_PAGE(rid), &home);
+}
+
+long heap_end(int part) {
+    DbHeader* header = partition_header(part);
+    if (header->num_pages == 0) return MAKE_LOC(part, 0);
+    return MAKE_LOC(part, MAKE_RID(header->num_pages - 1, header->tail_slots));
+}
+
+void heap_cursor_open(HeapCursor* c, FILE* f, int part, long start) {
+    c->f = f;
+    c->part = part;
+    c->page = RID_PAGE(start);
+    c->slot = RID_SLOT(start);
+    c->pages = partition_header(part)->num_pages;
+    c->loaded = 0;
+}
+
+int heap_cursor_next(HeapCursor* c, Row* out, long* loc) {
+    while (c->page < c->pages) {
+        if (!c->loaded) {
+            heap_read_page(c->f, c->part, c->page, &c->p);
+            c->loaded = 1;
+        }
+        if (c->slot >= c->p.slot_count) {
+            c->page++;
+            c->slot = 0;
+            c->loaded = 0;
+            continue;
+        }
+
+        int slot = c->slot++;
+        if (heap_page_row(c->f, c->part, &c->p, slot, out)) {
+            *loc = MAKE_LOC(c->part, MAKE_RID(c->page, slot));
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,826 @@
+#include "lsm.h"
+#include "txn.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Rows on disk and in the memtable keep a fixed width so a run can be
+// binary searched by position; Row is only used at the API boundary.
+typedef struct {
+    int id;
+    char name[LSM_NAME_SIZE];
+    int age;
+    int is_deleted;
+} LsmRow;
+
+typedef struct {
+    int level;
+    int seq;
+    int count;
+    int bloom_words;
+} RunHeader;
+
+typedef struct {
+    int next_id;
+    int next_seq;
+    int run_count;
+} LsmManifest;
+
+typedef struct {
+    int level;
+    int seq;
+} RunMeta;
+
+typedef struct {
+    RunHeader hdr;
+    uint64_t* bloom;
+} LsmRun;
+
+// The log is a sequence of batches: this header, count rows, then
+// LSM_WAL_COMMIT_MAGIC. Replay stops at the first batch missing its end.
+typedef struct {
+    int magic;
+    int count;
+} WalBatch;
+
+typedef struct {
+    LsmRow* rows;
+    int size;
+    int capacity;
+} RowBuffer;
+
+static RowBuffer memtable;          // sorted by id, only touched by the caller's thread
+static RowBuffer txn_rows;          // writes of the open transaction, sorted by id
+static LsmRun* runs;                // newest first: level ascending, seq descending
+static int run_count;
+static int run_capacity;
+static int next_id;
+static int txn_first_id;            // first id handed out in the open transaction, 0 if none
+static int next_seq;
+static FILE* wal;
+
+// lock guards runs, next_id, next_seq and the manifest file; the compactor
+// sleeps on work until a flush adds a run or lsm_close asks it to stop.
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_t compactor;
+static int shutting_down;
+
+static void run_path(int seq, char* buf, size_t size) {
+    snprintf(buf, size, "%s.%d.run", LSM_MANIFEST_FILE, seq);
+}
+
+static int sync_file(FILE* f) {
+    return fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+// Makes new and renamed directory entries (run files, the manifest) durable.
+static int sync_dir(void) {
+    int fd = open(".", O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+static long run_data_offset(const RunHeader* hdr) {
+    return sizeof(RunHeader) + (long)hdr->bloom_words * sizeof(uint64_t);
+}
+
+static uint32_t bloom_hash(int id, int i) {
+    uint32_t h1 = (uint32_t)id * 0x9E3779B1u;
+    uint32_t h2 = (((uint32_t)id ^ ((uint32_t)id >> 16)) * 0x85EBCA6Bu) | 1;
+    return h1 + (uint32_t)i * h2;
+}
+
+static void bloom_add(uint64_t* bloom, int words, int id) {
+    uint32_t bits = (uint32_t)words * 64;
+    for (int i = 0; i < 3; i++) {
+        uint32_t bit = bloom_hash(id, i) % bits;
+        bloom[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+}
+
+static int bloom_may_contain(const LsmRun* run, int id) {
+    uint32_t bits = (uint32_t)run->hdr.bloom_words * 64;
+    for (int i = 0; i < 3; i++) {
+        uint32_t bit = bloom_hash(id, i) % bits;
+        if (!(run->bloom[bit / 64] & ((uint64_t)1 << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+static void buffer_push(RowBuffer* buf, const LsmRow* row) {
+    if (buf->size >= buf->capacity) {
+        buf->capacity = buf->capacity ? buf->capacity * 2 : 64;
+        buf->rows = realloc(buf->rows, sizeof(LsmRow) * buf->capacity);
+        if (!buf->rows) { perror("realloc"); exit(1); }
+    }
+    buf->rows[buf->size++] = *row;
+}
+
+// Index of the first row with id >= target.
+static int lower_bound(const LsmRow* rows, int count, int target) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (rows[mid].id < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void sorted_put(RowBuffer* buf, const LsmRow* row) {
+    int pos = lower_bound(buf->rows, buf->size, row->id);
+    if (pos < buf->size && buf->rows[pos].id == row->id) {
+        buf->rows[pos] = *row;
+        return;
+    }
+
+    buffer_push(buf, row);  // grow; ids are mostly appended in order
+    if (pos < buf->size - 1) {
+        memmove(&buf->rows[pos + 1], &buf->rows[pos],
+                sizeof(LsmRow) * (buf->size - 1 - pos));
+        buf->rows[pos] = *row;
+    }
+}
+
+// Streams id-sorted rows into a new run file. The bloom filter is sized
+// for max_rows and the header goes in last, once the count is known.
+typedef struct {
+    FILE* f;
+    LsmRun run;
+    char path[64];
+} RunWriter;
+
+static int run_writer_open(RunWriter* w, int level, int seq, long max_rows) {
+    int words = (int)((max_rows * LSM_BLOOM_BITS_PER_ROW + 63) / 64);
+    w->run.hdr = (RunHeader){ level, seq, 0, words > 0 ? words : 1 };
+    w->run.bloom = calloc(w->run.hdr.bloom_words, sizeof(uint64_t));
+    if (!w->run.bloom) { perror("calloc"); return 0; }
+
+    run_path(seq, w->path, sizeof(w->path));
+    w->f = fopen(w->path, "wb");
+    if (!w->f) { perror("fopen"); free(w->run.bloom); return 0; }
+    fseek(w->f, run_data_offset(&w->run.hdr), SEEK_SET);
+    return 1;
+}
+
+static int run_writer_add(RunWriter* w, const LsmRow* row) {
+    bloom_add(w->run.bloom, w->run.hdr.bloom_words, row->id);
+    w->run.hdr.count++;
+    return fwrite(row, sizeof(LsmRow), 1, w->f) == 1;
+}
+
+// Completes and syncs the run. Returns 0, removing the file, if ok is 0 or
+// the file cannot be completed. A run that got no rows is removed as well
+// and leaves out->hdr.count at 0.
+static int run_writer_finish(RunWriter* w, int ok, LsmRun* out) {
+    if (ok) {
+        fseek(w->f, 0, SEEK_SET);
+        ok = fwrite(&w->run.hdr, sizeof(RunHeader), 1, w->f) == 1 &&
+             fwrite(w->run.bloom, sizeof(uint64_t), w->run.hdr.bloom_words, w->f) ==
+                 (size_t)w->run.hdr.bloom_words &&
+             sync_file(w->f);
+    }
+    ok = fclose(w->f) == 0 && ok;
+    if (!ok || w->run.hdr.count == 0) {
+        if (!ok) perror("lsm: write run");
+        remove(w->path);
+        free(w->run.bloom);
+        out->hdr.count = 0;
+        return ok;
+    }
+    *out = w->run;
+    return 1;
+}
+
+static int write_run(const LsmRow* rows, int count, int level, int seq, LsmRun* out) {
+    RunWriter w;
+    if (!run_writer_open(&w, level, seq, count)) return 0;
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) ok = run_writer_add(&w, &rows[i]);
+    return run_writer_finish(&w, ok, out);
+}
+
+// One id-sorted input of a merge: a run file read a block at a time, or
+// rows already in memory.
+typedef struct {
+    FILE* f;
+    int left;            // rows of the file not read yet
+    LsmRow* buf;
+    const LsmRow* rows;
+    int pos;
+    int size;
+    int failed;
+} Cursor;
+
+static int cursor_open_run(Cursor* c, const RunHeader* hdr) {
+    char path[64];
+    run_path(hdr->seq, path, sizeof(path));
+    memset(c, 0, sizeof(Cursor));
+    c->f = fopen(path, "rb");
+    if (!c->f) { perror("fopen"); return 0; }
+    c->buf = malloc(sizeof(LsmRow) * LSM_CURSOR_ROWS);
+    if (!c->buf) { perror("malloc"); exit(1); }
+    c->rows = c->buf;
+    c->left = hdr->count;
+    fseek(c->f, run_data_offset(hdr), SEEK_SET);
+    return 1;
+}
+
+static void cursor_open_rows(Cursor* c, const LsmRow* rows, int count) {
+    memset(c, 0, sizeof(Cursor));
+    c->rows = rows;
+    c->size = count;
+}
+
+static void cursor_close(Cursor* c) {
+    if (c->f) fclose(c->f);
+    free(c->buf);
+}
+
+// Current row, or NULL once the input is used up or a read failed.
+static const LsmRow* cursor_peek(Cursor* c) {
+    if (c->pos < c->size) return &c->rows[c->pos];
+    if (!c->f || c->left == 0 || c->failed) return NULL;
+
+    int want = c->left < LSM_CURSOR_ROWS ? c->left : LSM_CURSOR_ROWS;
+    if (fread(c->buf, sizeof(LsmRow), want, c->f) != (size_t)want) {
+        perror("lsm: read run");
+        c->failed = 1;
+        return NULL;
+    }
+    c->left -= want;
+    c->pos = 0;
+    c->size = want;
+    return &c->rows[0];
+}
+
+// Next row of a merge over cursors ordered newest first: the lowest id left,
+// in the version from the newest cursor holding it. Returns 0 at the end.
+static int merge_next(Cursor* c, int n, LsmRow* out) {
+    const LsmRow* best = NULL;
+    for (int i = 0; i < n; i++) {
+        const LsmRow* r = cursor_peek(&c[i]);
+        if (r && (!best || r->id < best->id)) best = r;
+    }
+    if (!best) return 0;
+
+    *out = *best;
+    for (int i = 0; i < n; i++) {
+        const LsmRow* r = cursor_peek(&c[i]);
+        if (r && r->id == out->id) c[i].pos++;
+    }
+    return 1;
+}
+
+static int load_run_meta(int seq, LsmRun* out) {
+    char path[64];
+    run_path(seq, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror("fopen"); return 0; }
+
+    if (fread(&out->hdr, sizeof(RunHeader), 1, f) != 1 || out->hdr.seq != seq ||
+        out->hdr.bloom_words <= 0 || out->hdr.count < 0) {
+        fclose(f);
+        return 0;
+    }
+    out->bloom = malloc(sizeof(uint64_t) * out->hdr.bloom_words);
+    int ok = out->bloom &&
+             fread(out->bloom, sizeof(uint64_t), out->hdr.bloom_words, f) == (size_t)out->hdr.bloom_words;
+    fclose(f);
+    if (!ok) free(out->bloom);
+    return ok;
+}
+
+static int run_find(const LsmRun* run, int id, LsmRow* out) {
+    char path[64];
+    run_path(run->hdr.seq, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+
+    long base = run_data_offset(&run->hdr);
+    int lo = 0, hi = run->hdr.count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        fseek(f, base + (long)mid * sizeof(LsmRow), SEEK_SET);
+        if (fread(out, sizeof(LsmRow), 1, f) != 1) break;
+        if (out->id == id) { fclose(f); return 1; }
+        if (out->id < id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    fclose(f);
+    return 0;
+}
+
+// Caller holds lock. Returns 1 once the manifest, the rename and the run
+// files it lists are all on disk.
+static int save_manifest(void) {
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", LSM_MANIFEST_FILE);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) { perror("fopen"); return 0; }
+
+    LsmManifest m = { next_id, next_seq, run_count };
+    int ok = fwrite(&m, sizeof(LsmManifest), 1, f) == 1;
+    for (int i = 0; i < run_count && ok; i++) {
+        RunMeta meta = { runs[i].hdr.level, runs[i].hdr.seq };
+        ok = fwrite(&meta, sizeof(RunMeta), 1, f) == 1;
+    }
+    ok = sync_file(f) && ok;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp, LSM_MANIFEST_FILE) == 0 && sync_dir();
+    if (!ok) perror("lsm: save manifest");
+    return ok;
+}
+
+// Caller holds lock. Keeps runs ordered newest first.
+static void install_run(const LsmRun* run) {
+    if (run_count >= run_capacity) {
+        run_capacity = run_capacity ? run_capacity * 2 : 16;
+        runs = realloc(runs, sizeof(LsmRun) * run_capacity);
+    }
+
+    int pos = 0;
+    while (pos < run_count &&
+           (runs[pos].hdr.level < run->hdr.level ||
+            (runs[pos].hdr.level == run->hdr.level && runs[pos].hdr.seq > run->hdr.seq))) {
+        pos++;
+    }
+    memmove(&runs[pos + 1], &runs[pos], sizeof(LsmRun) * (run_count - pos));
+    runs[pos] = *run;
+    run_count++;
+}
+
+// Caller holds lock.
+static void uninstall_run(int seq) {
+    for (int i = 0; i < run_count; i++) {
+        if (runs[i].hdr.seq == seq) {
+            free(runs[i].bloom);
+            memmove(&runs[i], &runs[i + 1], sizeof(LsmRun) * (run_count - i - 1));
+            run_count--;
+            return;
+        }
+    }
+}
+
+static long level_capacity(int level) {
+    long cap = (long)LSM_MEMTABLE_LIMIT * LSM_L0_LIMIT;
+    for (int i = 1; i < level; i++) cap *= LSM_LEVEL_RATIO;
+    return cap;
+}
+
+// Caller holds lock. Picks the next merge and returns a copy of its inputs,
+// newest first, or NULL when the tree is in shape.
+static RunHeader* pick_compaction(int* n, int* out_level) {
+    int l0 = 0;
+    for (int i = 0; i < run_count; i++) {
+        if (runs[i].hdr.level == 0) l0++;
+    }
+
+    int from = -1;
+    if (l0 >= LSM_L0_LIMIT) {
+        from = 0;
+    } else {
+        for (int i = 0; i < run_count; i++) {
+            int level = runs[i].hdr.level;
+            if (level > 0 && level < LSM_MAX_LEVELS - 1 &&
+                runs[i].hdr.count > level_capacity(level)) {
+                from = level;
+                break;
+            }
+        }
+    }
+    if (from < 0) return NULL;
+
+    RunHeader* inputs = malloc(sizeof(RunHeader) * run_count);
+    *n = 0;
+    for (int i = 0; i < run_count; i++) {
+        int level = runs[i].hdr.level;
+        if (level == from || level == from + 1) inputs[(*n)++] = runs[i].hdr;
+    }
+    *out_level = from + 1;
+    return inputs;
+}
+
+// Called with lock held and returns with it held; drops it while merging
+// so readers and flushes are only blocked for the final swap. Returns 0 if
+// the merge did not complete.
+static int compact(const RunHeader* inputs, int n, int level) {
+    int deepest = 1;
+    for (int i = 0; i < run_count; i++) {
+        if (runs[i].hdr.level > level) deepest = 0;
+    }
+    int seq = next_seq++;
+    pthread_mutex_unlock(&lock);
+
+    // inputs are newest first, as merge_next wants them
+    Cursor* cursors = calloc(n, sizeof(Cursor));
+    if (!cursors) { perror("calloc"); exit(1); }
+    long max_rows = 0;
+    int opened = 0, ok = 1;
+    for (int i = 0; i < n && ok; i++) {
+        ok = cursor_open_run(&cursors[i], &inputs[i]);
+        if (ok) opened++;
+        max_rows += inputs[i].count;
+    }
+
+    RunWriter w;
+    LsmRun out;
+    ok = ok && run_writer_open(&w, level, seq, max_rows);
+    if (ok) {
+        LsmRow row;
+        int wrote = 1;
+        while (wrote && merge_next(cursors, n, &row)) {
+            // nothing older is left below the deepest level for a tombstone to hide
+            if (deepest && row.is_deleted) continue;
+            wrote = run_writer_add(&w, &row);
+        }
+        for (int i = 0; i < n; i++) {
+            if (cursors[i].failed) wrote = 0;
+        }
+        ok = run_writer_finish(&w, wrote, &out);
+    }
+    int written = ok && out.hdr.count > 0;
+    for (int i = 0; i < opened; i++) cursor_close(&cursors[i]);
+    free(cursors);
+
+    pthread_mutex_lock(&lock);
+    if (!ok) {
+        fprintf(stderr, "lsm: compaction into level %d failed, inputs kept\n", level);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) uninstall_run(inputs[i].seq);
+    if (written) install_run(&out);
+    if (!save_manifest()) {
+        // the manifest on disk may still list the inputs, so their files stay
+        fprintf(stderr, "lsm: compaction into level %d not recorded, inputs kept on disk\n", level);
+        return 0;
+    }
+    pthread_mutex_unlock(&lock);
+
+    char path[64];
+    for (int i = 0; i < n; i++) {
+        run_path(inputs[i].seq, path, sizeof(path));
+        remove(path);
+    }
+
+    pthread_mutex_lock(&lock);
+    return 1;
+}
+
+// Caller holds lock. Sleeps for the backoff, waking early only to shut down.
+static void backoff_wait(int seconds) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += seconds;
+    while (!shutting_down && pthread_cond_timedwait(&work, &lock, &until) != ETIMEDOUT) {
+    }
+}
+
+static void* compactor_main(void* arg) {
+    (void)arg;
+    int backoff = 0;  // seconds; doubles while compactions keep failing
+    pthread_mutex_lock(&lock);
+    while (!shutting_down) {
+        int n, level;
+        RunHeader* inputs = pick_compaction(&n, &level);
+        if (inputs) {
+            int ok = compact(inputs, n, level);
+            free(inputs);
+            if (ok) {
+                backoff = 0;
+            } else {
+                // a full disk fails the same way every time; do not spin on it
+                backoff = backoff ? backoff * 2 : 1;
+                if (backoff > LSM_COMPACTION_MAX_BACKOFF) backoff = LSM_COMPACTION_MAX_BACKOFF;
+                backoff_wait(backoff);
+            }
+        } else {
+            pthread_cond_wait(&work, &lock);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+// Appends rows as one batch. On failure the torn batch is cut off again,
+// so the batches after it still replay.
+static int wal_append(const LsmRow* rows, int count, int sync) {
+    fseek(wal, 0, SEEK_END);
+    long start = ftell(wal);
+
+    WalBatch b = { LSM_WAL_BATCH_MAGIC, count };
+    int end = LSM_WAL_COMMIT_MAGIC;
+    int ok = fwrite(&b, sizeof(WalBatch), 1, wal) == 1 &&
+             fwrite(rows, sizeof(LsmRow), count, wal) == (size_t)count &&
+             fwrite(&end, sizeof(int), 1, wal) == 1 &&
+             fflush(wal) == 0 &&
+             (!sync || fsync(fileno(wal)) == 0);
+    if (ok) return 1;
+
+    perror("lsm: write log");
+    fclose(wal);
+    wal = NULL;
+    if (start < 0 || truncate(LSM_WAL_FILE, start) != 0) {
+        perror("lsm: cannot cut a torn batch from the log");
+        exit(1);
+    }
+    wal = fopen(LSM_WAL_FILE, "ab");
+    if (!wal) { perror("fopen"); exit(1); }
+    return 0;
+}
+
+// Replays complete batches into the memtable and returns the length of log
+// they cover. A batch torn by a crash mid-commit is left out.
+static long replay_wal(FILE* f) {
+    long good = 0;
+    LsmRow* rows = NULL;
+    WalBatch b;
+    while (fread(&b, sizeof(WalBatch), 1, f) == 1 &&
+           b.magic == LSM_WAL_BATCH_MAGIC && b.count >= 0) {
+        rows = realloc(rows, sizeof(LsmRow) * (b.count > 0 ? b.count : 1));
+        if (!rows) { perror("realloc"); exit(1); }
+        int end = 0;
+        if (fread(rows, sizeof(LsmRow), b.count, f) != (size_t)b.count ||
+            fread(&end, sizeof(int), 1, f) != 1 || end != LSM_WAL_COMMIT_MAGIC) {
+            break;
+        }
+        for (int i = 0; i < b.count; i++) {
+            sorted_put(&memtable, &rows[i]);
+            if (rows[i].id >= next_id) next_id = rows[i].id + 1;
+        }
+        good = ftell(f);
+    }
+    free(rows);
+    return good;
+}
+
+// Logs from before batches were framed hold bare rows.
+static void replay_legacy_wal(FILE* f) {
+    LsmRow r;
+    while (fread(&r, sizeof(LsmRow), 1, f) == 1) {
+        sorted_put(&memtable, &r);
+        if (r.id >= next_id) next_id = r.id + 1;
+    }
+}
+
+// Returns 1 once the memtable is in a run the manifest lists and the log
+// has been started over.
+static int flush_memtable(void) {
+    if (memtable.size == 0) return 1;
+
+    pthread_mutex_lock(&lock);
+    int seq = next_seq++;
+    pthread_mutex_unlock(&lock);
+
+    LsmRun run;
+    if (!write_run(memtable.rows, memtable.size, 0, seq, &run)) return 0;
+
+    pthread_mutex_lock(&lock);
+    install_run(&run);
+    int saved = save_manifest();
+    pthread_cond_signal(&work);
+    pthread_mutex_unlock(&lock);
+    memtable.size = 0;
+
+    // until a manifest listing the run is durable, the log still has to
+    // cover its rows; a later flush that saves the manifest truncates it
+    if (!saved) return 0;
+
+    // the run and the manifest are synced, so the log can start over
+    fclose(wal);
+    wal = fopen(LSM_WAL_FILE, "wb");
+    if (!wal) { perror("fopen"); exit(1); }
+    return 1;
+}
+
+void lsm_open(void) {
+    next_id = 1;
+    next_seq = 1;
+
+    FILE* f = fopen(LSM_MANIFEST_FILE, "rb");
+    if (f) {
+        // a run left out would bring back the rows its versions and
+        // tombstones replaced, so any damage stops the open
+        LsmManifest m;
+        if (fread(&m, sizeof(LsmManifest), 1, f) != 1 || m.run_count < 0) {
+            fprintf(stderr, "lsm: %s is truncated or corrupt\n", LSM_MANIFEST_FILE);
+            exit(1);
+        }
+        next_id = m.next_id;
+        next_seq = m.next_seq;
+        RunMeta meta;
+        for (int i = 0; i < m.run_count; i++) {
+            LsmRun run;
+            if (fread(&meta, sizeof(RunMeta), 1, f) != 1) {
+                fprintf(stderr, "lsm: %s is truncated or corrupt\n", LSM_MANIFEST_FILE);
+                exit(1);
+            }
+            if (!load_run_meta(meta.seq, &run)) {
+                char path[64];
+                run_path(meta.seq, path, sizeof(path));
+                fprintf(stderr, "lsm: %s, listed in %s, is missing or unreadable\n", path, LSM_MANIFEST_FILE);
+                exit(1);
+            }
+            install_run(&run);
+        }
+        fclose(f);
+    }
+
+    // replay rows written since the last flush
+    int legacy = 0;
+    f = fopen(LSM_WAL_FILE, "rb");
+    if (f) {
+        int magic;
+        legacy = fread(&magic, sizeof(int), 1, f) == 1 && magic != LSM_WAL_BATCH_MAGIC;
+        rewind(f);
+        if (legacy) {
+            replay_legacy_wal(f);
+        } else {
+            long good = replay_wal(f);
+            fseek(f, 0, SEEK_END);
+            if (ftell(f) > good) {
+                fprintf(stderr, "lsm: dropping an incomplete commit at the end of the log\n");
+                if (truncate(LSM_WAL_FILE, good) != 0) { perror("truncate"); exit(1); }
+            }
+        }
+        fclose(f);
+    }
+
+    wal = fopen(LSM_WAL_FILE, "ab");
+    if (!wal) { perror("fopen"); exit(1); }
+
+    // move old bare rows into a run so the log holds only batches
+    if (legacy && !flush_memtable()) {
+        fprintf(stderr, "lsm: could not convert %s to the batch format\n", LSM_WAL_FILE);
+        exit(1);
+    }
+
+    shutting_down = 0;
+    pthread_create(&compactor, NULL, compactor_main, NULL);
+    pthread_mutex_lock(&lock);
+    pthread_cond_signal(&work);
+    pthread_mutex_unlock(&lock);
+}
+
+void lsm_close(void) {
+    pthread_mutex_lock(&lock);
+    shutting_down = 1;
+    pthread_cond_signal(&work);
+    pthread_mutex_unlock(&lock);
+    pthread_join(compactor, NULL);
+
+    if (wal) fclose(wal);
+    wal = NULL;
+
+    for (int i = 0; i < run_count; i++) free(runs[i].bloom);
+    free(runs);
+    runs = NULL;
+    run_count = run_capacity = 0;
+
+    free(memtable.rows);
+    memtable = (RowBuffer){0};
+    free(txn_rows.rows);
+    txn_rows = (RowBuffer){0};
+}
+
+int lsm_next_id(void) {
+    pthread_mutex_lock(&lock);
+    int id = next_id++;
+    if (txn_active() && txn_first_id == 0) txn_first_id = id;
+    pthread_mutex_unlock(&lock);
+    return id;
+}
+
+static void to_lsm(const Row* r, LsmRow* out) {
+    memset(out, 0, sizeof(LsmRow));
+    out->id = r->id;
+    strncpy(out->name, r->name, LSM_NAME_SIZE - 1);
+    out->age = r->age;
+    out->is_deleted = r->is_deleted;
+}
+
+static void from_lsm(const LsmRow* r, Row* out) {
+    out->id = r->id;
+    snprintf(out->name, sizeof(out->name), "%s", r->name);
+    out->age = r->age;
+    out->is_deleted = r->is_deleted;
+}
+
+void lsm_put(const Row* r) {
+    LsmRow row;
+    to_lsm(r, &row);
+    if (txn_active()) {
+        sorted_put(&txn_rows, &row);
+        return;
+    }
+
+    wal_append(&row, 1, 0);
+
+    sorted_put(&memtable, &row);
+    if (memtable.size >= LSM_MEMTABLE_LIMIT) flush_memtable();
+}
+
+int lsm_commit(void) {
+    // one framed append and one sync make the whole batch durable
+    if (txn_rows.size > 0 && !wal_append(txn_rows.rows, txn_rows.size, 1)) return 0;
+
+    for (int i = 0; i < txn_rows.size; i++) {
+        sorted_put(&memtable, &txn_rows.rows[i]);
+    }
+    txn_rows.size = 0;
+    txn_first_id = 0;
+    if (memtable.size >= LSM_MEMTABLE_LIMIT) flush_memtable();
+    return 1;
+}
+
+void lsm_rollback(void) {
+    txn_rows.size = 0;
+
+    // ids handed out to rolled-back inserts are reused, as on the heap
+    if (txn_first_id) {
+        pthread_mutex_lock(&lock);
+        next_id = txn_first_id;
+        pthread_mutex_unlock(&lock);
+        txn_first_id = 0;
+    }
+}
+
+static int buffer_find(const RowBuffer* buf, int id, LsmRow* out) {
+    int pos = lower_bound(buf->rows, buf->size, id);
+    if (pos < buf->size && buf->rows[pos].id == id) {
+        *out = buf->rows[pos];
+        return 1;
+    }
+    return 0;
+}
+
+int lsm_get(int id, Row* out) {
+    LsmRow row;
+    int found = 0;
+    if (buffer_find(&txn_rows, id, &row) || buffer_find(&memtable, id, &row)) {
+        found = !row.is_deleted;
+    } else {
+        pthread_mutex_lock(&lock);
+        for (int i = 0; i < run_count; i++) {
+            if (!bloom_may_contain(&runs[i], id)) continue;
+            if (run_find(&runs[i], id, &row)) {
+                found = !row.is_deleted;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&lock);
+    }
+
+    if (found) from_lsm(&row, out);
+    return found;
+}
+
+static LsmRow* copy_rows(const RowBuffer* buf) {
+    LsmRow* rows = malloc(sizeof(LsmRow) * (buf->size > 0 ? buf->size : 1));
+    if (!rows) { perror("malloc"); exit(1); }
+    if (buf->size > 0) memcpy(rows, buf->rows, sizeof(LsmRow) * buf->size);
+    return rows;
+}
+
+void lsm_scan(ConditionList* conds, RowCallback callback) {
+    // callbacks may write back through lsm_put, so the scan reads copies of
+    // the in-memory rows; open run files stay readable even if a compaction
+    // removes them meanwhile
+    LsmRow* txn_copy = copy_rows(&txn_rows);
+    LsmRow* mem_copy = copy_rows(&memtable);
+
+    pthread_mutex_lock(&lock);
+    Cursor* cursors = calloc(run_count + 2, sizeof(Cursor));
+    if (!cursors) { perror("calloc"); exit(1); }
+    cursor_open_rows(&cursors[0], txn_copy, txn_rows.size);
+    cursor_open_rows(&cursors[1], mem_copy, memtable.size);
+    int n = 2;
+    for (int i = 0; i < run_count; i++) {
+        if (cursor_open_run(&cursors[n], &runs[i].hdr)) n++;
+    }
+    pthread_mutex_unlock(&lock);
+
+    LsmRow row;
+    Row r;
+    while (merge_next(cursors, n, &row)) {
+        if (row.is_deleted) continue;
+        from_lsm(&row, &r);
+        if (eval_condition_list(&r, conds)) {
+            callback(&r, -1, NULL);
+        }
+    }
+
+    for (int i = 0; i < n; i++) cursor_close(&cursors[i]);
+    free(cursors);
+    free(txn_copy);
+    free(mem_copy);
+}
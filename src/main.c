@@ -3,10 +3,24 @@
 #include "db.h"
 #include "parser.h"
 
-int main() {
-    db_init();
+int main(int argc, char** argv) {
+    DbOptions options = { ENGINE_HEAP, 0, 0 };
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--engine=", 9) == 0) options.engine_given = 1;
 
-    char command[256];
+        if (strcmp(argv[i], "--engine=lsm") == 0) options.engine = ENGINE_LSM;
+        else if (strcmp(argv[i], "--engine=heap") == 0) options.engine = ENGINE_HEAP;
+        else if (sscanf(argv[i], "--partition-rows=%d", &options.partition_rows) == 1 &&
+                 options.partition_rows >= 0) continue;
+        else {
+            fprintf(stderr, "usage: %s [--engine=heap|lsm] [--partition-rows=N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    db_init(&options);
+
+    char command[512];
     printf("Welcome to ProtoDB! Commands: insert, select, select where id=N, exit\n");
 
     while (1) {
@@ -18,8 +32,7 @@ int main() {
 
         switch (cmd.type) {
             case CMD_INSERT:
-                db_insert(&cmd.row);
-                printf("Inserted row.\n");
+                if (db_insert(&cmd.row)) printf("Inserted row.\n");
                 break;
             case CMD_SELECT_COND:
                 db_select_where(&cmd.conds);
@@ -39,11 +52,37 @@ int main() {
             case CMD_DELETE:
                 db_delete_by_id(cmd.query_id);
                 break;
+            case CMD_BEGIN:
+                db_begin();
+                break;
+            case CMD_COMMIT:
+                db_commit();
+                break;
+            case CMD_ROLLBACK:
+                db_rollback();
+                break;
+            case CMD_CACHE_STATS:
+                db_cache_stats();
+                break;
+            case CMD_DROP_PARTITION:
+                db_drop_partition(cmd.query_id);
+                break;
+            case CMD_CREATE_VIEW:
+                db_create_view(&cmd.view, &cmd.conds);
+                break;
+            case CMD_SELECT_VIEW:
+                db_select_view(cmd.view.name);
+                break;
+            case CMD_DROP_VIEW:
+                db_drop_view(cmd.view.name);
+                break;
             case CMD_EXIT:
+                db_close();
                 return 0;
             default:
                 printf("Unknown command.\n");
         }
     }
+    db_close();
     return 0;
 }
\ No newline at end of file
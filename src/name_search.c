@@ -0,0 +1,377 @@
+#include "name_search.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char* name;
+    long loc;
+} NameEntry;
+
+typedef struct Trigram {
+    uint32_t key;
+    long* locs;  // ascending
+    int size;
+    int capacity;
+    struct Trigram* next;
+} Trigram;
+
+// Names sit in a sorted base plus a small sorted delta of recent adds;
+// removals from the base only set a bit. Both are folded into a new base
+// once they outgrow about the square root of its size, so a write costs
+// O(sqrt n) amortized instead of shifting the whole array.
+static NameEntry* sorted;  // base, ordered by name, then location
+static int sorted_size;
+static int sorted_capacity;
+static uint8_t* removed;   // bit per base entry removed since the last fold
+static int removed_count;
+static NameEntry* delta;   // added since the last fold, same order
+static int delta_size;
+static int delta_capacity;
+static Trigram* buckets[TRIGRAM_BUCKETS];
+
+static uint32_t trigram_key(const char* s) {
+    return ((uint32_t)(unsigned char)s[0] << 16) |
+           ((uint32_t)(unsigned char)s[1] << 8) |
+           (uint32_t)(unsigned char)s[2];
+}
+
+static Trigram* trigram_find(uint32_t key, int create) {
+    uint32_t b = (key * 2654435761u) >> 16;
+    for (Trigram* t = buckets[b]; t; t = t->next) {
+        if (t->key == key) return t;
+    }
+    if (!create) return NULL;
+
+    Trigram* t = calloc(1, sizeof(Trigram));
+    if (!t) { perror("calloc"); exit(1); }
+    t->key = key;
+    t->next = buckets[b];
+    buckets[b] = t;
+    return t;
+}
+
+// Distinct trigram keys of s, so a name like "aaaa" posts its row once.
+static int trigrams_of(const char* s, uint32_t* keys) {
+    int n = 0;
+    int len = (int)strlen(s);
+    for (int i = 0; i + 3 <= len; i++) {
+        uint32_t key = trigram_key(s + i);
+        int seen = 0;
+        for (int j = 0; j < n && !seen; j++) seen = keys[j] == key;
+        if (!seen) keys[n++] = key;
+    }
+    return n;
+}
+
+static void reset_removed(void) {
+    free(removed);
+    removed = calloc(sorted_size / 8 + 1, 1);
+    if (!removed) { perror("calloc"); exit(1); }
+    removed_count = 0;
+}
+
+static int is_removed(int i) {
+    return (removed[i / 8] >> (i % 8)) & 1;
+}
+
+void name_search_init(void) {
+    sorted = delta = NULL;
+    sorted_size = sorted_capacity = delta_size = delta_capacity = 0;
+    removed = NULL;
+    reset_removed();
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void name_search_free(void) {
+    for (int i = 0; i < sorted_size; i++) free(sorted[i].name);
+    for (int i = 0; i < delta_size; i++) free(delta[i].name);
+    free(sorted);
+    free(delta);
+    free(removed);
+    sorted = delta = NULL;
+    removed = NULL;
+    sorted_size = sorted_capacity = delta_size = delta_capacity = removed_count = 0;
+
+    for (int b = 0; b < TRIGRAM_BUCKETS; b++) {
+        Trigram* t = buckets[b];
+        while (t) {
+            Trigram* next = t->next;
+            free(t->locs);
+            free(t);
+            t = next;
+        }
+        buckets[b] = NULL;
+    }
+}
+
+static int compare_entry(const char* name, long loc, const NameEntry* e) {
+    int c = strcmp(name, e->name);
+    if (c != 0) return c;
+    return (loc > e->loc) - (loc < e->loc);
+}
+
+// Index of the first entry of arr not ordered before (name, loc).
+static int lower_bound(const NameEntry* arr, int size, const char* name, long loc) {
+    int lo = 0, hi = size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (compare_entry(name, loc, &arr[mid]) > 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Index of the first posting of t not below loc.
+static int posting_bound(const Trigram* t, long loc) {
+    int lo = 0, hi = t->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (t->locs[mid] < loc) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Rewrites the base without its removed entries and with the delta merged in.
+static void fold(void) {
+    NameEntry* merged = malloc(sizeof(NameEntry) * (sorted_size - removed_count + delta_size + 1));
+    if (!merged) { perror("malloc"); exit(1); }
+    int n = 0, i = 0, j = 0;
+    while (i < sorted_size || j < delta_size) {
+        if (i < sorted_size && is_removed(i)) {
+            free(sorted[i++].name);
+        } else if (j >= delta_size ||
+                   (i < sorted_size && compare_entry(sorted[i].name, sorted[i].loc, &delta[j]) < 0)) {
+            merged[n++] = sorted[i++];
+        } else {
+            merged[n++] = delta[j++];
+        }
+    }
+    free(sorted);
+    sorted = merged;
+    sorted_size = n;
+    sorted_capacity = n + 1;
+    delta_size = 0;
+    reset_removed();
+}
+
+static void fold_if_due(void) {
+    int limit = NAME_SEARCH_MIN_DELTA;
+    while ((long)limit * limit < sorted_size) limit *= 2;
+    if (delta_size + removed_count > limit) fold();
+}
+
+// Adds loc to the postings of each trigram of name, keeping them ascending.
+static void post(const char* name, long loc) {
+    uint32_t keys[NAME_SIZE];
+    int n = trigrams_of(name, keys);
+    for (int i = 0; i < n; i++) {
+        Trigram* t = trigram_find(keys[i], 1);
+        if (t->size >= t->capacity) {
+            t->capacity = t->capacity ? t->capacity * 2 : 4;
+            t->locs = realloc(t->locs, sizeof(long) * t->capacity);
+            if (!t->locs) { perror("realloc"); exit(1); }
+        }
+        int at = posting_bound(t, loc);
+        memmove(&t->locs[at + 1], &t->locs[at], sizeof(long) * (t->size - at));
+        t->locs[at] = loc;
+        t->size++;
+    }
+}
+
+static void unpost(const char* name, long loc) {
+    uint32_t keys[NAME_SIZE];
+    int n = trigrams_of(name, keys);
+    for (int i = 0; i < n; i++) {
+        Trigram* t = trigram_find(keys[i], 0);
+        if (!t) continue;
+        int at = posting_bound(t, loc);
+        if (at < t->size && t->locs[at] == loc) {
+            memmove(&t->locs[at], &t->locs[at + 1], sizeof(long) * (t->size - at - 1));
+            t->size--;
+        }
+    }
+}
+
+// Takes every location in [lo, hi) out of the postings of name's trigrams.
+static void unpost_range(const char* name, long lo, long hi) {
+    uint32_t keys[NAME_SIZE];
+    int n = trigrams_of(name, keys);
+    for (int i = 0; i < n; i++) {
+        Trigram* t = trigram_find(keys[i], 0);
+        if (!t) continue;
+        int from = posting_bound(t, lo);
+        int to = posting_bound(t, hi);
+        memmove(&t->locs[from], &t->locs[to], sizeof(long) * (t->size - to));
+        t->size -= to - from;
+    }
+}
+
+static int compare_loc(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_name_entry(const void* a, const void* b) {
+    const NameEntry* e = a;
+    return compare_entry(e->name, e->loc, b);
+}
+
+void name_search_load(const char* name, long loc) {
+    if (sorted_size >= sorted_capacity) {
+        sorted_capacity = sorted_capacity ? sorted_capacity * 2 : 64;
+        sorted = realloc(sorted, sizeof(NameEntry) * sorted_capacity);
+        if (!sorted) { perror("realloc"); exit(1); }
+    }
+    sorted[sorted_size].name = strdup(name);
+    sorted[sorted_size].loc = loc;
+    sorted_size++;
+    post(name, loc);
+}
+
+void name_search_finish_load(void) {
+    if (sorted_size > 0)
+        qsort(sorted, sorted_size, sizeof(NameEntry), compare_name_entry);
+    reset_removed();
+}
+
+void name_search_add(const char* name, long loc) {
+    if (delta_size >= delta_capacity) {
+        delta_capacity = delta_capacity ? delta_capacity * 2 : 64;
+        delta = realloc(delta, sizeof(NameEntry) * delta_capacity);
+        if (!delta) { perror("realloc"); exit(1); }
+    }
+    int pos = lower_bound(delta, delta_size, name, loc);
+    memmove(&delta[pos + 1], &delta[pos], sizeof(NameEntry) * (delta_size - pos));
+    delta[pos].name = strdup(name);
+    delta[pos].loc = loc;
+    delta_size++;
+
+    post(name, loc);
+    fold_if_due();
+}
+
+// Takes (name, loc) out of the base or the delta; its postings are left.
+static int forget(const char* name, long loc) {
+    int pos = lower_bound(delta, delta_size, name, loc);
+    if (pos < delta_size && compare_entry(name, loc, &delta[pos]) == 0) {
+        free(delta[pos].name);
+        memmove(&delta[pos], &delta[pos + 1], sizeof(NameEntry) * (delta_size - pos - 1));
+        delta_size--;
+        return 1;
+    }
+
+    pos = lower_bound(sorted, sorted_size, name, loc);
+    if (pos >= sorted_size || compare_entry(name, loc, &sorted[pos]) != 0 || is_removed(pos)) return 0;
+    removed[pos / 8] |= (uint8_t)(1 << (pos % 8));
+    removed_count++;
+    return 1;
+}
+
+int name_search_remove(const char* name, long loc) {
+    if (!forget(name, loc)) return 0;
+    unpost(name, loc);
+    fold_if_due();
+    return 1;
+}
+
+void name_search_drop(const char* name, long loc, long lo, long hi) {
+    if (!forget(name, loc)) return;
+    unpost_range(name, lo, hi);
+    fold_if_due();
+}
+
+int name_search_contains(const char* name) {
+    int pos = lower_bound(delta, delta_size, name, -1);
+    if (pos < delta_size && strcmp(delta[pos].name, name) == 0) return 1;
+
+    for (int i = lower_bound(sorted, sorted_size, name, -1);
+         i < sorted_size && strcmp(sorted[i].name, name) == 0; i++) {
+        if (!is_removed(i)) return 1;
+    }
+    return 0;
+}
+
+// End of the run of arr from first whose names start with key, or equal it
+// when exact is set.
+static int prefix_end(const NameEntry* arr, int size, int first, const char* key, size_t len, int exact) {
+    int last = first;
+    while (last < size &&
+           (exact ? strcmp(arr[last].name, key) : strncmp(arr[last].name, key, len)) == 0) {
+        last++;
+    }
+    return last;
+}
+
+// Entries whose name starts with prefix, or equals it when exact is set.
+static int prefix_candidates(const char* prefix, size_t len, int exact, long** locs) {
+    char key[NAME_SIZE];
+    memcpy(key, prefix, len);
+    key[len] = '\0';
+
+    int first = lower_bound(sorted, sorted_size, key, -1);
+    int last = prefix_end(sorted, sorted_size, first, key, len, exact);
+    int delta_first = lower_bound(delta, delta_size, key, -1);
+    int delta_last = prefix_end(delta, delta_size, delta_first, key, len, exact);
+
+    *locs = malloc(sizeof(long) * (last - first + delta_last - delta_first + 1));
+    if (!*locs) { perror("malloc"); exit(1); }
+    int n = 0;
+    for (int i = first; i < last; i++) {
+        if (!is_removed(i)) (*locs)[n++] = sorted[i].loc;
+    }
+    for (int i = delta_first; i < delta_last; i++) (*locs)[n++] = delta[i].loc;
+    qsort(*locs, n, sizeof(long), compare_loc);
+    return n;
+}
+
+// Uses the rarest trigram of the literal as the candidate list.
+static int substring_candidates(const char* literal, size_t len, long** locs) {
+    char text[NAME_SIZE];
+    memcpy(text, literal, len);
+    text[len] = '\0';
+
+    uint32_t keys[NAME_SIZE];
+    int n = trigrams_of(text, keys);
+    Trigram* best = NULL;
+    for (int i = 0; i < n; i++) {
+        Trigram* t = trigram_find(keys[i], 0);
+        if (!t || t->size == 0) {
+            *locs = malloc(sizeof(long));
+            return 0;
+        }
+        if (!best || t->size < best->size) best = t;
+    }
+
+    *locs = malloc(sizeof(long) * best->size);
+    memcpy(*locs, best->locs, sizeof(long) * best->size);
+    return best->size;
+}
+
+int name_search_candidates(const Condition* c, long** locs) {
+    if (c->field != FIELD_NAME) return -1;
+
+    const char* s = c->str_value;
+    size_t len = strlen(s);
+    if (len >= NAME_SIZE) return -1;
+
+    if (c->op == OP_EQ) return prefix_candidates(s, len, 1, locs);
+    if (c->op == OP_CONTAINS) return len >= 3 ? substring_candidates(s, len, locs) : -1;
+    if (c->op != OP_LIKE) return -1;
+
+    // literal text before the first wildcard narrows by prefix
+    size_t lead = strcspn(s, "%_");
+    if (lead > 0) return prefix_candidates(s, lead, 0, locs);
+
+    // otherwise the longest literal run between wildcards, if it has a trigram
+    size_t best_at = 0, best_len = 0;
+    for (size_t i = 0; i < len;) {
+        size_t run = strcspn(s + i, "%_");
+        if (run > best_len) { best_at = i; best_len = run; }
+        i += run ? run : 1;
+    }
+    if (best_len >= 3) return substring_candidates(s + best_at, best_len, locs);
+    return -1;
+}
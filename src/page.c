@@ -0,0 +1,186 @@
+#include "page.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_BYTES 4
+#define RECORD_FIXED 8  // id and age
+
+typedef struct {
+    uint16_t offset;
+    uint16_t len;
+} Slot;
+
+static Slot get_slot(const Page* p, int slot) {
+    Slot s;
+    memcpy(&s, p->body + slot * SLOT_BYTES, sizeof(Slot));
+    return s;
+}
+
+static void set_slot(Page* p, int slot, Slot s) {
+    memcpy(p->body + slot * SLOT_BYTES, &s, sizeof(Slot));
+}
+
+void page_init(Page* p) {
+    memset(p, 0, sizeof(Page));
+    p->data_start = PAGE_BODY;
+}
+
+SlotState page_state(const Page* p, int slot) {
+    return (SlotState)((p->state[slot / 4] >> (slot % 4 * 2)) & 3);
+}
+
+void page_set_state(Page* p, int slot, SlotState state) {
+    int shift = slot % 4 * 2;
+    p->state[slot / 4] = (uint8_t)((p->state[slot / 4] & ~(3 << shift)) | (state << shift));
+
+    // a tombstone keeps its slot but gives its bytes back at the next compaction
+    if (state == SLOT_DELETED) {
+        Slot s = get_slot(p, slot);
+        s.len = 0;
+        set_slot(p, slot, s);
+    }
+}
+
+int page_record_len(const Row* r) {
+    return RECORD_FIXED + (int)strnlen(r->name, NAME_SIZE - 1);
+}
+
+void page_encode(const Row* r, uint8_t* rec) {
+    memcpy(rec, &r->id, sizeof(int));
+    memcpy(rec + 4, &r->age, sizeof(int));
+    memcpy(rec + RECORD_FIXED, r->name, page_record_len(r) - RECORD_FIXED);
+}
+
+void page_decode(const uint8_t* rec, int len, Row* out) {
+    int name_len = len - RECORD_FIXED;
+    memcpy(&out->id, rec, sizeof(int));
+    memcpy(&out->age, rec + 4, sizeof(int));
+    memcpy(out->name, rec + RECORD_FIXED, name_len);
+    out->name[name_len] = '\0';
+    out->is_deleted = 0;
+}
+
+void page_read(const Page* p, int slot, Row* out) {
+    Slot s = get_slot(p, slot);
+    page_decode(p->body + s.offset, s.len, out);
+}
+
+long page_target(const Page* p, int slot) {
+    Slot s = get_slot(p, slot);
+    int64_t target;
+    memcpy(&target, p->body + s.offset, sizeof(target));
+    return (long)target;
+}
+
+// Record bytes in use, not counting skip's.
+static int used_bytes(const Page* p, int skip) {
+    int used = 0;
+    for (int i = 0; i < p->slot_count; i++) {
+        if (i != skip) used += get_slot(p, i).len;
+    }
+    return used;
+}
+
+// Packs the records against the end of the body, dropping skip's.
+static void compact(Page* p, int skip) {
+    uint8_t old[PAGE_BODY];
+    memcpy(old, p->body, PAGE_BODY);
+
+    int end = PAGE_BODY;
+    for (int i = 0; i < p->slot_count; i++) {
+        Slot s = get_slot(p, i);
+        if (i == skip) s.len = 0;
+        end -= s.len;
+        memcpy(p->body + end, old + s.offset, s.len);
+        s.offset = (uint16_t)end;
+        set_slot(p, i, s);
+    }
+    p->data_start = (uint16_t)end;
+}
+
+// Takes len record bytes below data_start for slot, compacting first if
+// the free space between the directory and the records is too fragmented.
+// The caller has checked that the record fits in total.
+static void place(Page* p, int slot, const Row* r, int len) {
+    if (p->data_start - p->slot_count * SLOT_BYTES < len) compact(p, slot);
+    p->data_start -= len;
+    page_encode(r, p->body + p->data_start);
+    set_slot(p, slot, (Slot){ p->data_start, (uint16_t)len });
+}
+
+int page_add(Page* p, const Row* r, SlotState state) {
+    int len = page_record_len(r);
+    if (p->slot_count >= PAGE_MAX_SLOTS ||
+        (p->slot_count + 1) * SLOT_BYTES + used_bytes(p, -1) + len > PAGE_BODY) {
+        return -1;
+    }
+
+    // make room for the new directory entry before writing it
+    if (p->data_start - (p->slot_count + 1) * SLOT_BYTES < len) compact(p, -1);
+
+    int slot = p->slot_count++;
+    set_slot(p, slot, (Slot){ p->data_start, 0 });
+    place(p, slot, r, len);
+    page_set_state(p, slot, state);
+    return slot;
+}
+
+int page_put(Page* p, int slot, const Row* r) {
+    int len = page_record_len(r);
+    Slot s = get_slot(p, slot);
+
+    // shrinking or same-size records are rewritten where they are
+    if (len <= s.len) {
+        page_encode(r, p->body + s.offset);
+        s.len = (uint16_t)len;
+        set_slot(p, slot, s);
+        return 1;
+    }
+
+    if (p->slot_count * SLOT_BYTES + used_bytes(p, slot) + len > PAGE_BODY) return 0;
+
+    place(p, slot, r, len);
+    return 1;
+}
+
+void page_put_forward(Page* p, int slot, long target) {
+    Slot s = get_slot(p, slot);
+    int64_t t = target;
+    memcpy(p->body + s.offset, &t, sizeof(t));
+    s.len = sizeof(t);
+    set_slot(p, slot, s);
+    page_set_state(p, slot, SLOT_FORWARD);
+}
+
+int record_buffer_add(RecordBuffer* b, const Row* r, size_t limit) {
+    uint16_t len = (uint16_t)page_record_len(r);
+    size_t need = b->used + sizeof(len) + len;
+    if (limit && need > limit) return 0;
+    if (need > b->capacity) {
+        b->capacity = b->capacity ? b->capacity * 2 : 1024;
+        if (b->capacity < need) b->capacity = need;
+        if (limit && b->capacity > limit) b->capacity = limit;
+        b->data = realloc(b->data, b->capacity);
+        if (!b->data) { perror("realloc"); exit(1); }
+    }
+    memcpy(b->data + b->used, &len, sizeof(len));
+    page_encode(r, b->data + b->used + sizeof(len));
+    b->used = need;
+    return 1;
+}
+
+int record_buffer_next(const RecordBuffer* b, size_t* pos, Row* out) {
+    if (*pos >= b->used) return 0;
+    uint16_t len;
+    memcpy(&len, b->data + *pos, sizeof(len));
+    page_decode(b->data + *pos + sizeof(len), len, out);
+    *pos += sizeof(len) + len;
+    return 1;
+}
+
+void record_buffer_free(RecordBuffer* b) {
+    free(b->data);
+    b->data = NULL;
+    b->used = b->capacity = 0;
+}
@@ -10,10 +10,14 @@ Command parse_command(const char* input) {
 
     if (strncmp(input, "insert", 6) == 0) {
         Row r;
-        if (sscanf(input, "insert %31s %d", r.name, &r.age) == 2) {
+        if (sscanf(input, "insert %255s %d", r.name, &r.age) == 2) {
             cmd.type = CMD_INSERT;
             cmd.row = r;
         }
+    } else if (strncmp(input, "select view", 11) == 0) {
+        if (sscanf(input, "select view %31s", cmd.view.name) == 1) {
+            cmd.type = CMD_SELECT_VIEW;
+        }
     } else if (strncmp(input, "select where", 12) == 0) {
         Command cmd;
         cmd.type = CMD_SELECT_COND;
@@ -35,16 +39,7 @@ Command parse_command(const char* input) {
             char* value = strtok(NULL, " ");
 
             // fill condition
-            if (strcmp(field, "id") == 0) c.field = FIELD_ID;
-            else if (strcmp(field, "age") == 0) c.field = FIELD_AGE;
-            else if (strcmp(field, "name") == 0) c.field = FIELD_NAME;
-
-            if (strcmp(op, "=") == 0) c.op = OP_EQ;
-            else if (strcmp(op, ">") == 0) c.op = OP_GT;
-            else if (strcmp(op, "<") == 0) c.op = OP_LT;
-
-            if (c.field == FIELD_NAME) strncpy(c.str_value, value, sizeof(c.str_value));
-            else c.int_value = atoi(value);
+            if (!parse_condition(field, op, value, &c)) break;
 
             // add condition to list
             cmd.conds.conds[cmd.conds.cond_count++] = c;
@@ -83,16 +78,7 @@ Command parse_command(const char* input) {
             char* op = strtok(NULL, " ");
             char* value = strtok(NULL, " ");
 
-            if (strcmp(field, "id") == 0) c.field = FIELD_ID;
-            else if (strcmp(field, "age") == 0) c.field = FIELD_AGE;
-            else if (strcmp(field, "name") == 0) c.field = FIELD_NAME;
-
-            if (strcmp(op, "=") == 0) c.op = OP_EQ;
-            else if (strcmp(op, ">") == 0) c.op = OP_GT;
-            else if (strcmp(op, "<") == 0) c.op = OP_LT;
-
-            if (c.field == FIELD_NAME) strncpy(c.str_value, value, sizeof(c.str_value));
-            else c.int_value = atoi(value);
+            if (!parse_condition(field, op, value, &c)) break;
 
             cmd.conds.conds[cmd.conds.cond_count++] = c;
 
@@ -119,15 +105,15 @@ Command parse_command(const char* input) {
             cmd.row.age = atoi(value);
             cmd.row.name[0] = '\0';
         } else if (strcmp(field, "name") == 0) {
-            strncpy(cmd.row.name, value, sizeof(cmd.row.name));
+            snprintf(cmd.row.name, sizeof(cmd.row.name), "%s", value);
             cmd.row.age = -1;
         }
 
         return cmd;
     } else if (strncmp(input, "update", 6) == 0) {
         int id, age;
-        char name[32];
-        if (sscanf(input, "update %d %31s %d", &id, name, &age) == 3) {
+        char name[NAME_SIZE];
+        if (sscanf(input, "update %d %255s %d", &id, name, &age) == 3) {
             cmd.type = CMD_UPDATE;
             cmd.query_id = id;
             strncpy(cmd.row.name, name, sizeof(cmd.row.name));
@@ -153,16 +139,7 @@ Command parse_command(const char* input) {
             char* op = strtok(NULL, " ");
             char* value = strtok(NULL, " ");
 
-            if (strcmp(field, "id") == 0) c.field = FIELD_ID;
-            else if (strcmp(field, "age") == 0) c.field = FIELD_AGE;
-            else if (strcmp(field, "name") == 0) c.field = FIELD_NAME;
-
-            if (strcmp(op, "=") == 0) c.op = OP_EQ;
-            else if (strcmp(op, ">") == 0) c.op = OP_GT;
-            else if (strcmp(op, "<") == 0) c.op = OP_LT;
-
-            if (c.field == FIELD_NAME) strncpy(c.str_value, value, sizeof(c.str_value));
-            else c.int_value = atoi(value);
+            if (!parse_condition(field, op, value, &c)) break;
 
             cmd.conds.conds[cmd.conds.cond_count++] = c;
 
@@ -183,6 +160,72 @@ Command parse_command(const char* input) {
             cmd.type = CMD_DELETE;
             cmd.query_id = id;
         }
+    } else if (strncmp(input, "begin", 5) == 0) {
+        cmd.type = CMD_BEGIN;
+    } else if (strncmp(input, "commit", 6) == 0) {
+        cmd.type = CMD_COMMIT;
+    } else if (strncmp(input, "rollback", 8) == 0) {
+        cmd.type = CMD_ROLLBACK;
+    } else if (strncmp(input, "cache stats", 11) == 0) {
+        cmd.type = CMD_CACHE_STATS;
+    } else if (strncmp(input, "drop partition", 14) == 0) {
+        int part;
+        if (sscanf(input, "drop partition %d", &part) == 1) {
+            cmd.type = CMD_DROP_PARTITION;
+            cmd.query_id = part;
+        }
+    } else if (strncmp(input, "create view", 11) == 0) {
+        Command cmd;
+        cmd.type = CMD_UNKNOWN;
+
+        // create view <name> as count|sum <field> [where ...] [group by age]
+        char* token = strtok((char*)input, " ");
+        token = strtok(NULL, " "); // "view"
+        char* name = strtok(NULL, " ");
+        char* as = strtok(NULL, " ");
+        char* agg = strtok(NULL, " ");
+        if (!name || !as || strcmp(as, "as") != 0 || !agg || strlen(name) >= sizeof(cmd.view.name)) {
+            return cmd;
+        }
+        strcpy(cmd.view.name, name);
+        cmd.view.group_by_age = 0;
+        cmd.view.sum_field = FIELD_ID;
+
+        if (strcmp(agg, "count") == 0) {
+            cmd.view.agg = AGG_COUNT;
+        } else if (strcmp(agg, "sum") == 0) {
+            char* field = strtok(NULL, " ");
+            if (!field) return cmd;
+            cmd.view.agg = AGG_SUM;
+            if (strcmp(field, "id") == 0) cmd.view.sum_field = FIELD_ID;
+            else if (strcmp(field, "age") == 0) cmd.view.sum_field = FIELD_AGE;
+            else return cmd;
+        } else {
+            return cmd;
+        }
+
+        token = strtok(NULL, " ");
+        if (token && strcmp(token, "where") == 0) {
+            cmd.conds = parse_where_clause(NULL, &token);
+        } else {
+            cmd.conds = (ConditionList){ NULL, 0, NULL, 0 };
+        }
+
+        if (token && strcmp(token, "group") == 0) {
+            char* by = strtok(NULL, " ");
+            char* field = strtok(NULL, " ");
+            if (!by || strcmp(by, "by") != 0 || !field || strcmp(field, "age") != 0) return cmd;
+            cmd.view.group_by_age = 1;
+            token = strtok(NULL, " ");
+        }
+        if (token) return cmd;
+
+        cmd.type = CMD_CREATE_VIEW;
+        return cmd;
+    } else if (strncmp(input, "drop view", 9) == 0) {
+        if (sscanf(input, "drop view %31s", cmd.view.name) == 1) {
+            cmd.type = CMD_DROP_VIEW;
+        }
     } else if (strncmp(input, "exit", 4) == 0) {
         cmd.type = CMD_EXIT;
     }
@@ -0,0 +1,198 @@
+#include "partition.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int rows_per_partition;
+static int* present;
+static DbHeader* headers;
+static int count;
+static int capacity;
+
+static void read_header(int part) {
+    DbHeader* h = &headers[part];
+    FILE* f = partition_open(part, "rb");
+    if (!f || fread(h, sizeof(DbHeader), 1, f) != 1) {
+        *h = (DbHeader){ DB_MAGIC, 0, partition_first_id(part), 0 };
+    }
+    if (f) fclose(f);
+}
+
+void partition_init(int requested) {
+    rows_per_partition = 0;
+
+    FILE* meta = fopen(PARTITION_META_FILE, "rb");
+    if (meta) {
+        if (fread(&rows_per_partition, sizeof(int), 1, meta) != 1) rows_per_partition = 0;
+        fclose(meta);
+        if (requested && requested != rows_per_partition)
+            fprintf(stderr, "partition: table keeps %d rows per partition\n", rows_per_partition);
+    } else if (requested > 0) {
+        FILE* f = fopen(DB_FILE, "rb");
+        if (f) {
+            fclose(f);
+            fprintf(stderr, "partition: %s already exists, staying single-file\n", DB_FILE);
+        } else {
+            rows_per_partition = requested;
+            meta = fopen(PARTITION_META_FILE, "wb");
+            if (!meta) { perror("fopen"); exit(1); }
+            fwrite(&rows_per_partition, sizeof(int), 1, meta);
+            fclose(meta);
+        }
+    }
+
+    if (rows_per_partition == 0) {
+        FILE* f = fopen(DB_FILE, "rb");
+        if (f) {
+            fclose(f);
+            partition_add(0);
+        }
+        return;
+    }
+
+    DIR* dir = opendir(".");
+    if (!dir) { perror("opendir"); return; }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int part, len = 0;
+        if (sscanf(entry->d_name, PARTITION_FILE_FMT "%n", &part, &len) == 1 &&
+            entry->d_name[len] == '\0' && part >= 0) {
+            partition_add(part);
+        }
+    }
+    closedir(dir);
+}
+
+void partition_free(void) {
+    free(present);
+    free(headers);
+    present = NULL;
+    headers = NULL;
+    count = capacity = 0;
+}
+
+int partition_rows(void) {
+    return rows_per_partition;
+}
+
+int partition_count(void) {
+    return count;
+}
+
+int partition_exists(int part) {
+    return part >= 0 && part < count && present[part];
+}
+
+int partition_active(void) {
+    for (int part = count - 1; part >= 0; part--) {
+        if (present[part]) return part;
+    }
+    return -1;
+}
+
+int partition_for_id(int id) {
+    if (rows_per_partition == 0) return 0;
+    return (id - 1) / rows_per_partition;
+}
+
+int partition_first_id(int part) {
+    return part * rows_per_partition + 1;
+}
+
+void partition_add(int part) {
+    if (part >= capacity) {
+        int old = capacity;
+        capacity = capacity ? capacity * 2 : 16;
+        while (capacity <= part) capacity *= 2;
+        present = realloc(present, sizeof(int) * capacity);
+        headers = realloc(headers, sizeof(DbHeader) * capacity);
+        memset(&present[old], 0, sizeof(int) * (capacity - old));
+    }
+    if (part >= count) count = part + 1;
+    if (present[part]) return;
+
+    present[part] = 1;
+    read_header(part);
+}
+
+int partition_drop(int part) {
+    if (!partition_exists(part) || part == partition_active()) return 0;
+
+    char path[64];
+    partition_path(part, path, sizeof(path));
+    if (remove(path) != 0) { perror("remove"); return 0; }
+    present[part] = 0;
+    return 1;
+}
+
+void partition_trim_empty(void) {
+    int part;
+    while ((part = partition_active()) > 0) {
+        read_header(part);
+        if (headers[part].num_pages > 0) return;
+
+        int earlier = part - 1;
+        while (earlier >= 0 && !present[earlier]) earlier--;
+        if (earlier < 0) return;  // keep it: it alone remembers the next id
+
+        char path[64];
+        partition_path(part, path, sizeof(path));
+        if (remove(path) != 0) { perror("remove"); return; }
+        present[part] = 0;
+    }
+}
+
+void partition_reload_headers(void) {
+    for (int part = 0; part < count; part++) {
+        if (present[part]) read_header(part);
+    }
+}
+
+void partition_path(int part, char* buf, size_t size) {
+    if (rows_per_partition == 0) snprintf(buf, size, "%s", DB_FILE);
+    else snprintf(buf, size, PARTITION_FILE_FMT, part);
+}
+
+FILE* partition_open(int part, const char* mode) {
+    char path[64];
+    partition_path(part, path, sizeof(path));
+    return fopen(path, mode);
+}
+
+DbHeader* partition_header(int part) {
+    return &headers[part];
+}
+
+// Whether some id in [lo, hi] can satisfy c; non-id conditions always can.
+static int range_may_match(Condition* c, int lo, int hi) {
+    if (c->field != FIELD_ID) return 1;
+
+    int v = c->int_value;
+    switch (c->op) {
+        case OP_EQ:  return lo <= v && v <= hi;
+        case OP_GT:  return hi > v;
+        case OP_LT:  return lo < v;
+        case OP_GTE: return hi >= v;
+        case OP_LTE: return lo <= v;
+        case OP_NEQ: return !(lo == v && hi == v);
+        default:     return 1;
+    }
+}
+
+int partition_may_match(int part, ConditionList* conds) {
+    if (rows_per_partition == 0 || conds->cond_count == 0) return 1;
+
+    int lo = partition_first_id(part);
+    int hi = lo + rows_per_partition - 1;
+
+    // may-match is monotone in AND/OR, so folding it like
+    // eval_condition_list never prunes a partition with a real match
+    int result = range_may_match(&conds->conds[0], lo, hi);
+    for (int j = 0; j < conds->op_count; j++) {
+        int rhs = range_may_match(&conds->conds[j + 1], lo, hi);
+        if (conds->ops[j] == LOGICAL_AND) result = result && rhs;
+        else if (conds->ops[j] == LOGICAL_OR) result = result || rhs;
+    }
+    return result;
+}
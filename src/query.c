@@ -1,8 +1,37 @@
+#define _GNU_SOURCE  // memmem
 #include "query.h"
 #include "db.h"
+#include "heap.h"
+#include "lsm.h"
+#include "name_search.h"
+#include "partition.h"
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+// SQL LIKE over NUL-terminated strings: % matches any run, _ any one char.
+static int like_match(const char* s, const char* p) {
+    const char* star = NULL;
+    const char* resume = NULL;
+    while (*s) {
+        if (*p == '%') {
+            star = p++;
+            resume = s;
+        } else if (*p == '_' || *p == *s) {
+            p++;
+            s++;
+        } else if (star) {
+            p = star + 1;
+            s = ++resume;
+        } else {
+            return 0;
+        }
+    }
+    while (*p == '%') p++;
+    return *p == '\0';
+}
+
 int eval_condition(Row* r, Condition* cond) {
     switch (cond->field) {
         case FIELD_ID:
@@ -17,6 +46,10 @@ int eval_condition(Row* r, Condition* cond) {
             break;
         case FIELD_NAME:
             if (cond->op == OP_EQ) return strcmp(r->name, cond->str_value) == 0;
+            if (cond->op == OP_LIKE) return like_match(r->name, cond->str_value);
+            if (cond->op == OP_CONTAINS)
+                return memmem(r->name, strlen(r->name),
+                              cond->str_value, strlen(cond->str_value)) != NULL;
             break;
     }
     return 0;
@@ -34,24 +67,212 @@ int eval_condition_list(Row* r, ConditionList* conds) {
     return result;
 }
 
+// Picks the narrowest name_search lookup among conditions that must all
+// hold; returns its candidate count, or -1 if a full scan is needed.
+static int plan_name_lookup(ConditionList* conds, long** locs) {
+    for (int j = 0; j < conds->op_count; j++) {
+        if (conds->ops[j] != LOGICAL_AND) return -1;
+    }
+
+    int best = -1;
+    for (int i = 0; i < conds->cond_count; i++) {
+        long* found;
+        int n = name_search_candidates(&conds->conds[i], &found);
+        if (n < 0) continue;
+        if (best < 0 || n < best) {
+            if (best >= 0) free(*locs);
+            *locs = found;
+            best = n;
+        } else {
+            free(found);
+        }
+    }
+    return best;
+}
+
+// Finds an id = N that every match must satisfy, so the LSM engine can
+// read that one row through its bloom filters instead of merging all runs.
+static int plan_id_lookup(ConditionList* conds, int* id) {
+    for (int j = 0; j < conds->op_count; j++) {
+        if (conds->ops[j] != LOGICAL_AND) return 0;
+    }
+    for (int i = 0; i < conds->cond_count; i++) {
+        if (conds->conds[i].field == FIELD_ID && conds->conds[i].op == OP_EQ) {
+            *id = conds->conds[i].int_value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Visits candidate rows in location order, one partition file at a time.
+static void scan_candidates(ConditionList* conds, long* locs, int n, RowCallback callback) {
+    int i = 0;
+    while (i < n) {
+        int part = LOC_PART(locs[i]);
+        FILE* f = partition_open(part, "r+b");
+        if (!f) { perror("fopen"); return; }
+        heap_load_header(f, part);
+
+        Row r;
+        for (; i < n && LOC_PART(locs[i]) == part; i++) {
+            if (!heap_read_row(f, locs[i], &r)) continue;
+
+            if (eval_condition_list(&r, conds)) {
+                callback(&r, locs[i], f);
+            }
+        }
+        fclose(f);
+    }
+}
+
 void scan_rows(ConditionList* conds, RowCallback callback) {
-    FILE* f = fopen(DB_FILE, "r+b");
+    if (get_engine() == ENGINE_LSM) {
+        int id;
+        Row r;
+        if (!plan_id_lookup(conds, &id)) lsm_scan(conds, callback);
+        else if (lsm_get(id, &r) && eval_condition_list(&r, conds)) callback(&r, -1, NULL);
+        return;
+    }
+
+    long* locs;
+    int n = plan_name_lookup(conds, &locs);
+    if (n >= 0) {
+        scan_candidates(conds, locs, n, callback);
+        free(locs);
+        return;
+    }
+
+    scan_rows_from(conds, 0, callback);
+}
+
+typedef struct {
+    int part;
+    long start;      // row id to start reading at
+    ConditionList* conds;
+    RecordBuffer rows;  // matches, filled by a worker
+    long* locs;
+    int size;
+    int capacity;       // of locs
+    int done;        // set under the queue lock once rows are complete
+} PartitionScan;
+
+typedef struct {
+    PartitionScan* scans;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} ScanQueue;
+
+static void collect_matches(PartitionScan* s) {
+    FILE* f = partition_open(s->part, "rb");
     if (!f) { perror("fopen"); return; }
 
-    load_header(f);
-    DbHeader* header = get_header();
+    HeapCursor c;
     Row r;
+    long loc;
+    heap_cursor_open(&c, f, s->part, s->start);
+    while (heap_cursor_next(&c, &r, &loc)) {
+        if (!eval_condition_list(&r, s->conds)) continue;
 
-    for (int i = 0; i < header->num_rows; i++) {
-        long offset = sizeof(DbHeader) + i * sizeof(Row);
-        fseek(f, offset, SEEK_SET);
-        fread(&r, sizeof(Row), 1, f);
-        if (r.is_deleted) continue;
+        if (s->size >= s->capacity) {
+            s->capacity = s->capacity ? s->capacity * 2 : 64;
+            s->locs = realloc(s->locs, sizeof(long) * s->capacity);
+            if (!s->locs) { perror("realloc"); exit(1); }
+        }
+        record_buffer_add(&s->rows, &r, 0);
+        s->locs[s->size] = loc;
+        s->size++;
+    }
+    fclose(f);
+}
 
-        if (eval_condition_list(&r, conds)) {
-            callback(&r, offset, f);
+static void* scan_worker(void* arg) {
+    ScanQueue* q = arg;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        int i = q->next++;
+        pthread_mutex_unlock(&q->lock);
+        if (i >= q->count) return NULL;
+        collect_matches(&q->scans[i]);
+
+        pthread_mutex_lock(&q->lock);
+        q->scans[i].done = 1;
+        pthread_cond_broadcast(&q->finished);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+void scan_rows_from(ConditionList* conds, long start, RowCallback callback) {
+    int first = LOC_PART(start);
+    int total = partition_count();
+    PartitionScan* scans = calloc(total > 0 ? total : 1, sizeof(PartitionScan));
+    int n = 0;
+
+    // headers are loaded here, on this thread; workers only read rows
+    for (int part = first; part < total; part++) {
+        if (!partition_exists(part) || !partition_may_match(part, conds)) continue;
+
+        FILE* f = partition_open(part, "rb");
+        if (!f) { perror("fopen"); continue; }
+        heap_load_header(f, part);
+        fclose(f);
+
+        PartitionScan* s = &scans[n++];
+        s->part = part;
+        s->start = part == first ? LOC_OFFSET(start) : 0;
+        s->conds = conds;
+    }
+
+    if (n == 1) {
+        // nothing to overlap; stream the rows straight to the callback
+        PartitionScan* s = &scans[0];
+        FILE* f = partition_open(s->part, "r+b");
+        if (f) {
+            HeapCursor c;
+            Row r;
+            long loc;
+            heap_cursor_open(&c, f, s->part, s->start);
+            while (heap_cursor_next(&c, &r, &loc)) {
+                if (eval_condition_list(&r, conds)) {
+                    callback(&r, loc, f);
+                }
+            }
+            fclose(f);
         }
+    } else if (n > 1) {
+        ScanQueue q = { scans, n, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+        int workers = n < PARTITION_SCAN_THREADS ? n : PARTITION_SCAN_THREADS;
+        pthread_t threads[PARTITION_SCAN_THREADS];
+        for (int i = 0; i < workers; i++) pthread_create(&threads[i], NULL, scan_worker, &q);
+
+        // callbacks may write, so they run here in partition order, each
+        // partition as soon as its worker is done; a callback only writes
+        // the partition it was handed, which no worker reads any more
+        for (int i = 0; i < n; i++) {
+            PartitionScan* s = &scans[i];
+            pthread_mutex_lock(&q.lock);
+            while (!s->done) pthread_cond_wait(&q.finished, &q.lock);
+            pthread_mutex_unlock(&q.lock);
+
+            FILE* f = s->size ? partition_open(s->part, "r+b") : NULL;
+            Row r;
+            size_t pos = 0;
+            for (int j = 0; f && record_buffer_next(&s->rows, &pos, &r); j++) {
+                callback(&r, s->locs[j], f);
+            }
+            if (f) fclose(f);
+            record_buffer_free(&s->rows);
+            free(s->locs);
+            s->locs = NULL;
+        }
+        for (int i = 0; i < workers; i++) pthread_join(threads[i], NULL);
     }
 
-    fclose(f);
-}
\ No newline at end of file
+    for (int i = 0; i < n; i++) {
+        record_buffer_free(&scans[i].rows);
+        free(scans[i].locs);
+    }
+    free(scans);
+}
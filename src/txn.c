@@ -0,0 +1,236 @@
+#include "txn.h"
+#include "partition.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    long loc;
+    Page page;
+} TxnWrite;
+
+typedef struct {
+    int part;
+    DbHeader header;
+} TxnHeader;
+
+static int active;
+static TxnWrite* writes;  // sorted by location, so grouped by partition
+static int write_count;
+static int write_capacity;
+static TxnHeader* headers;
+static int header_count;
+
+// Parallel partition scans read pages on worker threads while callbacks on
+// the main thread buffer writes to partitions already scanned.
+static pthread_mutex_t write_set_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int txn_active(void) {
+    return active;
+}
+
+void txn_begin(void) {
+    active = 1;
+    write_count = 0;
+    header_count = 0;
+}
+
+void txn_end(void) {
+    active = 0;
+    free(writes);
+    free(headers);
+    writes = NULL;
+    headers = NULL;
+    write_count = write_capacity = header_count = 0;
+}
+
+// Index of the first write with loc >= target.
+static int find_slot(long target) {
+    int lo = 0, hi = write_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (writes[mid].loc < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void txn_write(long loc, const Page* page) {
+    pthread_mutex_lock(&write_set_lock);
+    int pos = find_slot(loc);
+    if (pos < write_count && writes[pos].loc == loc) {
+        writes[pos].page = *page;
+        pthread_mutex_unlock(&write_set_lock);
+        return;
+    }
+
+    if (write_count >= write_capacity) {
+        write_capacity = write_capacity ? write_capacity * 2 : 64;
+        writes = realloc(writes, sizeof(TxnWrite) * write_capacity);
+        if (!writes) { perror("realloc"); exit(1); }
+    }
+    memmove(&writes[pos + 1], &writes[pos], sizeof(TxnWrite) * (write_count - pos));
+    writes[pos].loc = loc;
+    writes[pos].page = *page;
+    write_count++;
+    pthread_mutex_unlock(&write_set_lock);
+}
+
+int txn_read(long loc, Page* out) {
+    pthread_mutex_lock(&write_set_lock);
+    int pos = find_slot(loc);
+    int found = pos < write_count && writes[pos].loc == loc;
+    if (found) *out = writes[pos].page;
+    pthread_mutex_unlock(&write_set_lock);
+    return found;
+}
+
+void txn_write_header(int part, const DbHeader* header) {
+    for (int i = 0; i < header_count; i++) {
+        if (headers[i].part == part) {
+            headers[i].header = *header;
+            return;
+        }
+    }
+    headers = realloc(headers, sizeof(TxnHeader) * (header_count + 1));
+    if (!headers) { perror("realloc"); exit(1); }
+    headers[header_count].part = part;
+    headers[header_count].header = *header;
+    header_count++;
+}
+
+int txn_read_header(int part, DbHeader* out) {
+    for (int i = 0; i < header_count; i++) {
+        if (headers[i].part == part) {
+            *out = headers[i].header;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int sync_file(FILE* f) {
+    return fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+// Writes each run of adjacent pages with one seek and one fwrite, then the
+// partition header if it changed.
+static int apply_partition(int part, const TxnWrite* w, int n, const DbHeader* header) {
+    FILE* f = partition_open(part, "r+b");
+    if (!f) f = partition_open(part, "w+b");
+    if (!f) { perror("fopen"); return 0; }
+
+    Page* run = malloc(sizeof(Page) * (n > 0 ? n : 1));
+    int ok = 1;
+    int i = 0;
+    while (i < n && ok) {
+        int len = 0;
+        long start = LOC_OFFSET(w[i].loc);
+        while (i < n && LOC_OFFSET(w[i].loc) == start + (long)len * (long)sizeof(Page)) {
+            run[len++] = w[i++].page;
+        }
+        fseek(f, start, SEEK_SET);
+        ok = fwrite(run, sizeof(Page), len, f) == (size_t)len;
+    }
+    free(run);
+
+    if (ok && header) {
+        fseek(f, 0, SEEK_SET);
+        ok = fwrite(header, sizeof(DbHeader), 1, f) == 1;
+    }
+    ok = ok && sync_file(f);
+    fclose(f);
+
+    if (ok) partition_add(part);
+    return ok;
+}
+
+static const DbHeader* find_header(const TxnHeader* h, int n, int part) {
+    for (int i = 0; i < n; i++) {
+        if (h[i].part == part) return &h[i].header;
+    }
+    return NULL;
+}
+
+static int apply_all(const TxnHeader* h, int hn, const TxnWrite* w, int wn) {
+    int i = 0;
+    while (i < wn) {
+        int part = LOC_PART(w[i].loc);
+        int start = i;
+        while (i < wn && LOC_PART(w[i].loc) == part) i++;
+        if (!apply_partition(part, &w[start], i - start, find_header(h, hn, part))) return 0;
+    }
+
+    // partitions whose header moved without any row landing in them
+    for (int k = 0; k < hn; k++) {
+        int written = 0;
+        for (int j = 0; j < wn && !written; j++) {
+            if (LOC_PART(w[j].loc) == h[k].part) written = 1;
+        }
+        if (!written && !apply_partition(h[k].part, NULL, 0, &h[k].header)) return 0;
+    }
+    return 1;
+}
+
+int txn_commit(void) {
+    FILE* j = fopen(TXN_JOURNAL_FILE, "wb");
+    if (!j) { perror("fopen"); return 0; }
+
+    int magic = TXN_JOURNAL_MAGIC;
+    int ok = fwrite(&header_count, sizeof(int), 1, j) == 1 &&
+             fwrite(headers, sizeof(TxnHeader), header_count, j) == (size_t)header_count &&
+             fwrite(&write_count, sizeof(int), 1, j) == 1 &&
+             fwrite(writes, sizeof(TxnWrite), write_count, j) == (size_t)write_count &&
+             fwrite(&magic, sizeof(int), 1, j) == 1 &&
+             sync_file(j);
+    fclose(j);
+    if (!ok) {
+        remove(TXN_JOURNAL_FILE);
+        return 0;
+    }
+
+    // the journal is the durability point; from here on the commit is redone
+    // by txn_recover if applying it does not finish. Files left half-written
+    // must not take further writes, or recovery would later lay the journal's
+    // older page images over them, so stop and let the next start redo it.
+    if (!apply_all(headers, header_count, writes, write_count)) {
+        fprintf(stderr, "txn: apply failed, journal kept; restart to recover\n");
+        exit(1);
+    }
+    remove(TXN_JOURNAL_FILE);
+    return 1;
+}
+
+void txn_recover(void) {
+    FILE* j = fopen(TXN_JOURNAL_FILE, "rb");
+    if (!j) return;
+
+    int hn = 0, wn = 0, magic = 0;
+    TxnHeader* h = NULL;
+    TxnWrite* w = NULL;
+    int ok = fread(&hn, sizeof(int), 1, j) == 1 && hn >= 0;
+    if (ok) {
+        h = malloc(sizeof(TxnHeader) * (hn > 0 ? hn : 1));
+        ok = fread(h, sizeof(TxnHeader), hn, j) == (size_t)hn &&
+             fread(&wn, sizeof(int), 1, j) == 1 && wn >= 0;
+    }
+    if (ok) {
+        w = malloc(sizeof(TxnWrite) * (wn > 0 ? wn : 1));
+        ok = fread(w, sizeof(TxnWrite), wn, j) == (size_t)wn &&
+             fread(&magic, sizeof(int), 1, j) == 1 &&
+             magic == TXN_JOURNAL_MAGIC;
+    }
+    fclose(j);
+
+    // a torn journal means the commit never reached its durability point
+    if (ok && !apply_all(h, hn, w, wn)) {
+        free(h);
+        free(w);
+        return;
+    }
+    free(h);
+    free(w);
+    remove(TXN_JOURNAL_FILE);
+}
@@ -0,0 +1,297 @@
+#include "views.h"
+#include "query.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    ViewSpec spec;
+    int cond_count;
+    int op_count;
+    Condition conds[VIEW_MAX_CONDS];
+    LogicalOp ops[VIEW_MAX_CONDS];
+    long value;        // aggregate over all matching rows
+    long rows;
+    int group_count;
+} ViewHeader;
+
+typedef struct {
+    int key;           // age
+    long value;
+    long rows;
+} ViewGroup;
+
+typedef struct {
+    ViewHeader h;
+    ViewGroup* groups; // sorted by key
+    int group_capacity;
+} View;
+
+static View views[MAX_VIEWS];
+static int view_count;
+static View saved[MAX_VIEWS];
+static int saved_count = -1;  // -1 when no save point is held
+static View* target;          // view being filled by a scan
+
+// Written to a temporary file and renamed over VIEW_FILE, so a crash leaves
+// either the old definitions or the new ones, never a truncated file.
+static void write_file(int dirty) {
+    FILE* f = fopen(VIEW_TMP_FILE, "wb");
+    if (!f) { perror("fopen"); return; }
+
+    int magic = VIEW_MAGIC;
+    fwrite(&magic, sizeof(int), 1, f);
+    fwrite(&dirty, sizeof(int), 1, f);
+    fwrite(&view_count, sizeof(int), 1, f);
+    for (int i = 0; i < view_count; i++) {
+        fwrite(&views[i].h, sizeof(ViewHeader), 1, f);
+        if (views[i].h.group_count > 0)
+            fwrite(views[i].groups, sizeof(ViewGroup), views[i].h.group_count, f);
+    }
+    int ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(VIEW_TMP_FILE, VIEW_FILE) != 0) {
+        perror("views");
+        remove(VIEW_TMP_FILE);
+    }
+}
+
+// Definitions exist nowhere else, so a file this build cannot read is left
+// alone rather than replaced by an empty list.
+static void refuse(const char* why) {
+    fprintf(stderr, "views: %s %s; move it aside to start without views\n", VIEW_FILE, why);
+    exit(1);
+}
+
+static void free_view(View* v) {
+    free(v->groups);
+    v->groups = NULL;
+    v->group_capacity = 0;
+    v->h.group_count = 0;
+}
+
+static void reset_view(View* v) {
+    v->h.value = 0;
+    v->h.rows = 0;
+    v->h.group_count = 0;
+}
+
+static int view_matches(View* v, const Row* row) {
+    ConditionList conds = { v->h.conds, v->h.cond_count, v->h.ops, v->h.op_count };
+    return eval_condition_list((Row*)row, &conds);
+}
+
+static long row_value(View* v, const Row* row) {
+    if (v->h.spec.agg == AGG_COUNT) return 1;
+    return v->h.spec.sum_field == FIELD_ID ? row->id : row->age;
+}
+
+static ViewGroup* find_group(View* v, int key, int create) {
+    int lo = 0, hi = v->h.group_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (v->groups[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < v->h.group_count && v->groups[lo].key == key) return &v->groups[lo];
+    if (!create) return NULL;
+
+    if (v->h.group_count >= v->group_capacity) {
+        v->group_capacity = v->group_capacity ? v->group_capacity * 2 : 16;
+        v->groups = realloc(v->groups, sizeof(ViewGroup) * v->group_capacity);
+        if (!v->groups) { perror("realloc"); exit(1); }
+    }
+    memmove(&v->groups[lo + 1], &v->groups[lo], sizeof(ViewGroup) * (v->h.group_count - lo));
+    v->groups[lo] = (ViewGroup){ key, 0, 0 };
+    v->h.group_count++;
+    return &v->groups[lo];
+}
+
+// Adds (sign 1) or retracts (sign -1) one row's contribution.
+static void apply_row(View* v, const Row* row, int sign) {
+    long delta = sign * row_value(v, row);
+    v->h.value += delta;
+    v->h.rows += sign;
+    if (!v->h.spec.group_by_age) return;
+
+    ViewGroup* g = find_group(v, row->age, sign > 0);
+    if (!g) return;
+    g->value += delta;
+    g->rows += sign;
+    if (g->rows == 0) {
+        int i = (int)(g - v->groups);
+        memmove(&v->groups[i], &v->groups[i + 1], sizeof(ViewGroup) * (v->h.group_count - i - 1));
+        v->h.group_count--;
+    }
+}
+
+static void fill_view(Row* r, long offset, FILE* f) {
+    (void)offset;
+    (void)f;
+    apply_row(target, r, 1);
+}
+
+static void compute(View* v) {
+    reset_view(v);
+    ConditionList conds = { v->h.conds, v->h.cond_count, v->h.ops, v->h.op_count };
+    target = v;
+    scan_rows(&conds, fill_view);
+}
+
+void views_open(void) {
+    view_count = 0;
+    FILE* f = fopen(VIEW_FILE, "rb");
+    if (!f) return;
+
+    int magic = 0, dirty = 1, count = 0;
+    if (fread(&magic, sizeof(int), 1, f) != 1 || magic != VIEW_MAGIC) {
+        refuse("was written by an incompatible version");
+    }
+    if (fread(&dirty, sizeof(int), 1, f) != 1 ||
+        fread(&count, sizeof(int), 1, f) != 1 || count < 0 || count > MAX_VIEWS) {
+        refuse("is truncated or corrupt");
+    }
+
+    for (int i = 0; i < count; i++) {
+        View* v = &views[view_count];
+        memset(v, 0, sizeof(View));
+        if (fread(&v->h, sizeof(ViewHeader), 1, f) != 1) refuse("is truncated or corrupt");
+        v->group_capacity = v->h.group_count;
+        v->groups = malloc(sizeof(ViewGroup) * (v->group_capacity ? v->group_capacity : 1));
+        if (fread(v->groups, sizeof(ViewGroup), v->h.group_count, f) != (size_t)v->h.group_count) {
+            free_view(v);
+            dirty = 1;
+        }
+        view_count++;
+    }
+    fclose(f);
+
+    if (dirty) views_rebuild();
+
+    // stays dirty on disk until views_close writes the final aggregates
+    write_file(1);
+}
+
+void views_close(void) {
+    if (view_count > 0) write_file(0);
+    for (int i = 0; i < view_count; i++) free_view(&views[i]);
+    view_count = 0;
+    views_release_point();
+}
+
+static View* find_view(const char* name) {
+    for (int i = 0; i < view_count; i++) {
+        if (strcmp(views[i].h.spec.name, name) == 0) return &views[i];
+    }
+    return NULL;
+}
+
+int views_create(const ViewSpec* spec, ConditionList* conds) {
+    if (find_view(spec->name)) {
+        printf("Error: view '%s' already exists.\n", spec->name);
+        return 0;
+    }
+    if (view_count >= MAX_VIEWS) {
+        printf("Error: at most %d views.\n", MAX_VIEWS);
+        return 0;
+    }
+    if (conds->cond_count > VIEW_MAX_CONDS) {
+        printf("Error: at most %d conditions in a view.\n", VIEW_MAX_CONDS);
+        return 0;
+    }
+
+    View* v = &views[view_count];
+    memset(v, 0, sizeof(View));
+    v->h.spec = *spec;
+    v->h.cond_count = conds->cond_count;
+    v->h.op_count = conds->op_count;
+    if (conds->cond_count > 0) {
+        memcpy(v->h.conds, conds->conds, sizeof(Condition) * conds->cond_count);
+        memcpy(v->h.ops, conds->ops, sizeof(LogicalOp) * conds->op_count);
+    }
+    view_count++;
+
+    compute(v);
+    write_file(1);
+    return 1;
+}
+
+int views_drop(const char* name) {
+    View* v = find_view(name);
+    if (!v) return 0;
+
+    free_view(v);
+    int i = (int)(v - views);
+    memmove(&views[i], &views[i + 1], sizeof(View) * (view_count - i - 1));
+    view_count--;
+    write_file(1);
+    return 1;
+}
+
+int views_print(const char* name) {
+    View* v = find_view(name);
+    if (!v) return 0;
+
+    char label[16];
+    if (v->h.spec.agg == AGG_COUNT) snprintf(label, sizeof(label), "count");
+    else snprintf(label, sizeof(label), "sum(%s)", v->h.spec.sum_field == FIELD_ID ? "id" : "age");
+
+    if (!v->h.spec.group_by_age) {
+        printf("View %s: %s=%ld\n", name, label, v->h.value);
+        return 1;
+    }
+    for (int i = 0; i < v->h.group_count; i++) {
+        printf("View %s: age=%d %s=%ld\n", name, v->groups[i].key, label, v->groups[i].value);
+    }
+    return 1;
+}
+
+void views_rebuild(void) {
+    for (int i = 0; i < view_count; i++) compute(&views[i]);
+}
+
+void views_on_insert(const Row* row) {
+    for (int i = 0; i < view_count; i++) {
+        if (view_matches(&views[i], row)) apply_row(&views[i], row, 1);
+    }
+}
+
+void views_on_delete(const Row* row) {
+    for (int i = 0; i < view_count; i++) {
+        if (view_matches(&views[i], row)) apply_row(&views[i], row, -1);
+    }
+}
+
+void views_on_update(const Row* before, const Row* after) {
+    for (int i = 0; i < view_count; i++) {
+        if (view_matches(&views[i], before)) apply_row(&views[i], before, -1);
+        if (view_matches(&views[i], after)) apply_row(&views[i], after, 1);
+    }
+}
+
+void views_save_point(void) {
+    views_release_point();
+    for (int i = 0; i < view_count; i++) {
+        saved[i] = views[i];
+        saved[i].group_capacity = views[i].h.group_count;
+        saved[i].groups = malloc(sizeof(ViewGroup) * (saved[i].group_capacity ? saved[i].group_capacity : 1));
+        if (views[i].h.group_count > 0)
+            memcpy(saved[i].groups, views[i].groups, sizeof(ViewGroup) * views[i].h.group_count);
+    }
+    saved_count = view_count;
+}
+
+void views_restore_point(void) {
+    if (saved_count < 0) return;
+    for (int i = 0; i < view_count; i++) free_view(&views[i]);
+    memcpy(views, saved, sizeof(View) * saved_count);
+    view_count = saved_count;
+    saved_count = -1;
+}
+
+void views_release_point(void) {
+    if (saved_count < 0) return;
+    for (int i = 0; i < saved_count; i++) free_view(&saved[i]);
+    saved_count = -1;
+}
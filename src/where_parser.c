@@ -2,11 +2,40 @@
 #include <string.h>
 #include <stdlib.h>
 
-ConditionList parse_where_clause(char* input) {
+int parse_condition(const char* field, const char* op, const char* value, Condition* c) {
+    if (!field || !op || !value) return 0;
+
+    if (strcmp(field, "id") == 0) c->field = FIELD_ID;
+    else if (strcmp(field, "age") == 0) c->field = FIELD_AGE;
+    else if (strcmp(field, "name") == 0) c->field = FIELD_NAME;
+
+    if (strcmp(op, "=") == 0) c->op = OP_EQ;
+    else if (strcmp(op, ">") == 0) c->op = OP_GT;
+    else if (strcmp(op, "<") == 0) c->op = OP_LT;
+    else if (strcmp(op, "like") == 0) c->op = OP_LIKE;
+    else if (strcmp(op, "contains") == 0) c->op = OP_CONTAINS;
+
+    if (c->field == FIELD_NAME) {
+        // patterns may be quoted: name like 'abc%'
+        size_t len = strlen(value);
+        if (len >= 2 && value[0] == '\'' && value[len - 1] == '\'') {
+            value++;
+            len -= 2;
+        }
+        if (len >= sizeof(c->str_value)) len = sizeof(c->str_value) - 1;
+        memcpy(c->str_value, value, len);
+        c->str_value[len] = '\0';
+    } else {
+        c->int_value = atoi(value);
+    }
+    return 1;
+}
+
+ConditionList parse_where_clause(char* input, char** stop) {
     ConditionList conds;
-    conds.conds = malloc(sizeof(Condition) * 16);
+    conds.conds = malloc(sizeof(Condition) * WHERE_MAX_TERMS);
     conds.cond_count = 0;
-    conds.ops = malloc(sizeof(LogicalOp) * 16);
+    conds.ops = malloc(sizeof(LogicalOp) * WHERE_MAX_TERMS);
     conds.op_count = 0;
 
     char* token = strtok(input, " ");
@@ -16,30 +45,22 @@ ConditionList parse_where_clause(char* input) {
         char* op = strtok(NULL, " ");
         char* value = strtok(NULL, " ");
 
-        if (!field || !op || !value) break;
-
-        if (strcmp(field, "id") == 0) c.field = FIELD_ID;
-        else if (strcmp(field, "age") == 0) c.field = FIELD_AGE;
-        else if (strcmp(field, "name") == 0) c.field = FIELD_NAME;
-
-        if (strcmp(op, "=") == 0) c.op = OP_EQ;
-        else if (strcmp(op, ">") == 0) c.op = OP_GT;
-        else if (strcmp(op, "<") == 0) c.op = OP_LT;
-
-        if (c.field == FIELD_NAME) strncpy(c.str_value, value, sizeof(c.str_value));
-        else c.int_value = atoi(value);
+        if (!parse_condition(field, op, value, &c)) break;
 
         conds.conds[conds.cond_count++] = c;
 
-        char* next = strtok(NULL, " ");
-        if (next && (strcmp(next, "and") == 0 || strcmp(next, "or") == 0)) {
+        // a term past the bound is left to the caller, which sees the "and"
+        token = strtok(NULL, " ");
+        if (token && conds.cond_count < WHERE_MAX_TERMS &&
+            (strcmp(token, "and") == 0 || strcmp(token, "or") == 0)) {
             conds.ops[conds.op_count++] =
-                (strcmp(next, "and") == 0) ? LOGICAL_AND : LOGICAL_OR;
+                (strcmp(token, "and") == 0) ? LOGICAL_AND : LOGICAL_OR;
             token = strtok(NULL, " ");
         } else {
             break;
         }
     }
 
+    if (stop) *stop = token;
     return conds;
 }